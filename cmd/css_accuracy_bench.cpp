@@ -0,0 +1,300 @@
+#include "Recognition.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// =======================================================================================================
+// css_accuracy_bench: Recognition accuracy next to latency on transformed copies of the database
+//
+// Builds the database from a directory of images (database/ by default) and queries it with
+// labelled variants of the same images: rotated, rescaled, with added pixel noise, with the contour
+// start point shifted, and all four combined. Reports top-1/top-5 accuracy and query latency per
+// transform so that a change to the CSS computation or the distance can be accepted or rejected on
+// data. --min-top1 turns it into a gate: the exit code is 2 when overall top-1 falls below it.
+//
+// Usage: css_accuracy_bench [database_dir] [--variants N] [--seed S] [--resample N] [--scales N]
+//                           [--json results.json] [--min-top1 0.9]
+//
+// ChangeLogs
+//    Oct 18, 2026    Created as a ranking regression check for performance work
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    enum Transform
+    {
+        Rotate,
+        Scale,
+        Noise,
+        Shift,
+        Combined,
+        NumTransforms
+    };
+
+    const char *kTransformNames[NumTransforms] = {"rotate", "scale", "noise", "shift", "combined"};
+
+    struct Variant
+    {
+        double angleDeg = 0.0;
+        double scale = 1.0;
+        double noiseSigma = 0.0; // gray levels
+        double startShift = 0.0; // fraction of the contour
+    };
+
+    Variant drawVariant(Transform transform, std::mt19937 &rng)
+    {
+        std::uniform_real_distribution<double> angle(0.0, 360.0), scale(0.5, 1.5), noise(5.0, 20.0), shift(0.0, 1.0);
+        Variant v;
+        if (transform == Rotate || transform == Combined)
+            v.angleDeg = angle(rng);
+        if (transform == Scale || transform == Combined)
+            v.scale = scale(rng);
+        if (transform == Noise || transform == Combined)
+            v.noiseSigma = noise(rng);
+        if (transform == Shift || transform == Combined)
+            v.startShift = shift(rng);
+        return v;
+    }
+
+    // Image-space part of a variant; the canvas grows so a rotated object is never clipped
+    cv::Mat applyVariant(const cv::Mat &image, const Variant &v, std::mt19937 &rng)
+    {
+        cv::Mat out;
+        cv::resize(image, out, cv::Size(), v.scale, v.scale, v.scale < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR);
+
+        if (v.angleDeg != 0.0)
+        {
+            const cv::Point2f center(out.cols / 2.0f, out.rows / 2.0f);
+            const double c = std::abs(std::cos(v.angleDeg * CV_PI / 180.0)), s = std::abs(std::sin(v.angleDeg * CV_PI / 180.0));
+            const cv::Size bounds(cvRound(out.cols * c + out.rows * s), cvRound(out.cols * s + out.rows * c));
+            cv::Mat rotation = cv::getRotationMatrix2D(center, v.angleDeg, 1.0);
+            rotation.at<double>(0, 2) += bounds.width / 2.0 - center.x;
+            rotation.at<double>(1, 2) += bounds.height / 2.0 - center.y;
+            cv::Mat rotated;
+            cv::warpAffine(out, rotated, rotation, bounds, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+            out = rotated;
+        }
+
+        if (v.noiseSigma > 0.0)
+        {
+            cv::theRNG().state = rng();
+            cv::Mat noise(out.size(), CV_32F);
+            cv::randn(noise, 0.0, v.noiseSigma);
+            cv::Mat noisy;
+            out.convertTo(noisy, CV_32F);
+            cv::add(noisy, noise, noisy);
+            noisy.convertTo(out, CV_8U);
+        }
+        return out;
+    }
+
+    double percentile(std::vector<double> values, double p)
+    {
+        if (values.empty())
+        {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+        return values[std::min(values.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+    struct TransformStats
+    {
+        int queries = 0;
+        int found = 0; // a contour was extracted
+        int top1 = 0;
+        int top5 = 0;
+        std::vector<double> latencies;
+
+        double rate(int hits) const { return queries ? static_cast<double>(hits) / queries : 0.0; }
+        double meanMs() const
+        {
+            double sum = 0.0;
+            for (double l : latencies)
+                sum += l;
+            return latencies.empty() ? 0.0 : sum / latencies.size();
+        }
+        void add(const TransformStats &other)
+        {
+            queries += other.queries;
+            found += other.found;
+            top1 += other.top1;
+            top5 += other.top5;
+            latencies.insert(latencies.end(), other.latencies.begin(), other.latencies.end());
+        }
+    };
+}
+
+int main(int argc, char **argv)
+{
+    std::string databaseDir = "database";
+    int variants = 5;
+    unsigned seed = 1;
+    int resamplePoints = -1;
+    int numScales = -1;
+    std::string jsonPath;
+    double minTop1 = -1.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--variants" && i + 1 < argc)
+            variants = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (arg == "--resample" && i + 1 < argc)
+            resamplePoints = std::stoi(argv[++i]);
+        else if (arg == "--scales" && i + 1 < argc)
+            numScales = std::stoi(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (arg == "--min-top1" && i + 1 < argc)
+            minTop1 = std::stod(argv[++i]);
+        else
+            databaseDir = arg;
+    }
+
+    recognition::Recognition recognizer;
+    recognizer.setResultCacheCapacity(0); // repeated variants must not be answered from the cache
+    if (resamplePoints >= 0)
+        recognizer.setResamplePoints(resamplePoints);
+    if (numScales > 0)
+        recognizer.setCSSParameters(recognizer.getParameters().maxSigma, numScales);
+
+    // Labelled by file stem, like Recognition::loadShapeDatabase
+    std::vector<std::pair<std::string, cv::Mat>> labelled;
+    if (std::filesystem::is_directory(databaseDir))
+    {
+        for (const auto &entry : std::filesystem::directory_iterator(databaseDir))
+        {
+            const std::string ext = entry.path().extension().string();
+            if (!entry.is_regular_file() ||
+                (ext != ".png" && ext != ".jpg" && ext != ".jpeg" && ext != ".bmp" && ext != ".tif"))
+            {
+                continue;
+            }
+            cv::Mat image = cv::imread(entry.path().string(), cv::IMREAD_GRAYSCALE);
+            if (!image.empty())
+            {
+                labelled.emplace_back(entry.path().stem().string(), image);
+            }
+        }
+    }
+    std::sort(labelled.begin(), labelled.end(), [](const std::pair<std::string, cv::Mat> &a, const std::pair<std::string, cv::Mat> &b)
+              { return a.first < b.first; });
+
+    for (const auto &item : labelled)
+    {
+        recognizer.addShape(item.first, item.second);
+    }
+    if (recognizer.getDatabaseSize() == 0)
+    {
+        std::cerr << "Error: no shapes loaded from " << databaseDir << std::endl;
+        return 1;
+    }
+
+    std::mt19937 rng(seed);
+    std::vector<TransformStats> stats(NumTransforms);
+    for (const auto &item : labelled)
+    {
+        for (int t = 0; t < NumTransforms; t++)
+        {
+            for (int v = 0; v < variants; v++)
+            {
+                const Variant variant = drawVariant(static_cast<Transform>(t), rng);
+                const cv::Mat query = applyVariant(item.second, variant, rng);
+                TransformStats &s = stats[t];
+                s.queries++;
+
+                const Clock::time_point start = Clock::now();
+                recognition::QueryShape shape;
+                std::vector<recognition::ShapeEntry> matches;
+                if (recognizer.extractQuery(query, shape))
+                {
+                    std::vector<cv::Point> &contour = shape.contour;
+                    const size_t shift = static_cast<size_t>(variant.startShift * contour.size()) % contour.size();
+                    std::rotate(contour.begin(), contour.begin() + shift, contour.end());
+                    matches = recognizer.recognizeShape(contour, 5);
+                    s.found++;
+                }
+                s.latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+                for (size_t r = 0; r < matches.size(); r++)
+                {
+                    if (matches[r].name == item.first)
+                    {
+                        s.top1 += r == 0 ? 1 : 0;
+                        s.top5++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    TransformStats overall;
+    for (const auto &s : stats)
+    {
+        overall.add(s);
+    }
+
+    const recognition::DatabaseParams params = recognizer.getParameters();
+    std::cout << "\n=== Accuracy Benchmark (" << labelled.size() << " shapes, " << variants
+              << " variants per transform, " << params.numScales << " scales, resample " << params.resamplePoints
+              << ") ===" << std::endl;
+    std::cout << std::left << std::setw(10) << "transform" << std::right << std::setw(9) << "queries"
+              << std::setw(8) << "found" << std::setw(8) << "top-1" << std::setw(8) << "top-5"
+              << std::setw(11) << "mean ms" << std::setw(11) << "p95 ms" << std::endl;
+    auto printRow = [](const std::string &name, const TransformStats &s)
+    {
+        std::cout << std::left << std::setw(10) << name << std::right << std::setw(9) << s.queries
+                  << std::setw(8) << s.found << std::fixed << std::setprecision(3) << std::setw(8) << s.rate(s.top1)
+                  << std::setw(8) << s.rate(s.top5) << std::setprecision(2) << std::setw(11) << s.meanMs()
+                  << std::setw(11) << percentile(s.latencies, 95) << std::endl;
+    };
+    for (int t = 0; t < NumTransforms; t++)
+    {
+        printRow(kTransformNames[t], stats[t]);
+    }
+    printRow("overall", overall);
+
+    if (!jsonPath.empty())
+    {
+        std::ofstream json(jsonPath);
+        json << "{\n  \"shapes\": " << labelled.size() << ", \"variants\": " << variants << ", \"seed\": " << seed
+             << ", \"num_scales\": " << params.numScales << ", \"resample_points\": " << params.resamplePoints
+             << ",\n  \"transforms\": {";
+        for (int t = 0; t <= NumTransforms; t++)
+        {
+            const TransformStats &s = t < NumTransforms ? stats[t] : overall;
+            json << (t ? "," : "") << "\n    \"" << (t < NumTransforms ? kTransformNames[t] : "overall")
+                 << "\": {\"queries\": " << s.queries << ", \"found\": " << s.found << ", \"top1\": " << s.rate(s.top1)
+                 << ", \"top5\": " << s.rate(s.top5) << ", \"mean_ms\": " << s.meanMs()
+                 << ", \"p50_ms\": " << percentile(s.latencies, 50) << ", \"p95_ms\": " << percentile(s.latencies, 95) << "}";
+        }
+        json << "\n  }\n}\n";
+        std::cout << "\nResults written to: " << jsonPath << std::endl;
+    }
+
+    if (minTop1 >= 0.0 && overall.rate(overall.top1) < minTop1)
+    {
+        std::cerr << "Top-1 accuracy " << overall.rate(overall.top1) << " is below the required " << minTop1 << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include "CSS.h"
+#include "Recognition.h"
+#include "toed/cpu_toed.hpp"
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// =======================================================================================================
+// css_bench: Micro-benchmarks of the CSS, matching and TOED hot paths (Google Benchmark)
+//
+// Inputs are generated at runtime: a wobbly closed curve for the contour kernels, a noisy sinusoid
+// for zero-crossing detection, random (arcLength, sigma) sets for matching and a filled star on a
+// white background for contour extraction and TOED. Run with --benchmark_filter=<regex> to select
+// kernels and --benchmark_format=json to compare runs.
+//
+// ChangeLogs
+//    Oct 18, 2026    Created for hot path regression tracking
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace
+{
+    // Closed curve of n points with a few lobes, so curvature changes sign along it
+    std::vector<cv::Point2d> wobblyCurve(int n, double radius = 200.0)
+    {
+        std::vector<cv::Point2d> curve(n);
+        for (int i = 0; i < n; i++)
+        {
+            const double t = 2.0 * CV_PI * i / n;
+            const double r = radius * (1.0 + 0.2 * std::sin(5.0 * t) + 0.08 * std::sin(13.0 * t));
+            curve[i] = cv::Point2d(300.0 + r * std::cos(t), 300.0 + r * std::sin(t));
+        }
+        return curve;
+    }
+
+    std::vector<cv::Point> roundedCurve(int n)
+    {
+        std::vector<cv::Point> contour;
+        for (const auto &pt : wobblyCurve(n, n / (2.0 * CV_PI)))
+        {
+            contour.emplace_back(cvRound(pt.x), cvRound(pt.y));
+        }
+        return contour;
+    }
+
+    std::vector<std::pair<double, double>> randomZeroCrossings(int count, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<double> arc(0.0, 1.0), sigma(0.0, 4.0);
+        std::vector<std::pair<double, double>> zc(count);
+        for (auto &p : zc)
+        {
+            p = {arc(rng), sigma(rng)};
+        }
+        return zc;
+    }
+
+    // Filled five-pointed star covering most of a size x size image
+    cv::Mat starImage(int size)
+    {
+        cv::Mat image(size, size, CV_8UC1, cv::Scalar(255));
+        std::vector<cv::Point> star;
+        for (int i = 0; i < 10; i++)
+        {
+            const double r = (i % 2 == 0 ? 0.45 : 0.2) * size;
+            const double t = CV_PI * i / 5.0 - CV_PI / 2.0;
+            star.emplace_back(cvRound(size / 2.0 + r * std::cos(t)), cvRound(size / 2.0 + r * std::sin(t)));
+        }
+        cv::fillPoly(image, std::vector<std::vector<cv::Point>>{star}, cv::Scalar(0), cv::LINE_AA);
+        return image;
+    }
+}
+
+// ============================================================================
+// CSS
+// ============================================================================
+
+// Args: contour points, sigma
+static void BM_ComputeDerivativesWithGaussian(benchmark::State &state)
+{
+    css::CSS css;
+    const auto curve = wobblyCurve(static_cast<int>(state.range(0)));
+    const double sigma = static_cast<double>(state.range(1));
+    std::vector<double> dx, dy, d2x, d2y;
+    for (auto _ : state)
+    {
+        css.computeDerivativesWithGaussian(curve, sigma, dx, dy, d2x, d2y);
+        benchmark::DoNotOptimize(d2y.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ComputeDerivativesWithGaussian)
+    ->ArgsProduct({{128, 256, 512, 2048}, {1, 4}})
+    ->ArgNames({"points", "sigma"});
+
+// Args: contour points, number of scales
+static void BM_ComputeCSS(benchmark::State &state)
+{
+    css::CSS css;
+    const auto contour = roundedCurve(static_cast<int>(state.range(0)));
+    for (auto _ : state)
+    {
+        css::CSSImage image = css.computeCSS(contour, 4.0, static_cast<int>(state.range(1)));
+        benchmark::DoNotOptimize(image.zeroCrossings.data());
+    }
+}
+BENCHMARK(BM_ComputeCSS)
+    ->ArgsProduct({{128, 256, 512, 2048}, {10, 20, 40}})
+    ->ArgNames({"points", "scales"})
+    ->Unit(benchmark::kMicrosecond);
+
+// Args: curvature samples
+static void BM_FindZeroCrossings(benchmark::State &state)
+{
+    css::CSS css;
+    const int n = static_cast<int>(state.range(0));
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0.0, 0.05);
+    std::vector<double> curvature(n);
+    for (int i = 0; i < n; i++)
+    {
+        curvature[i] = std::sin(2.0 * CV_PI * 12.0 * i / n) + noise(rng);
+    }
+
+    for (auto _ : state)
+    {
+        std::vector<int> crossings = css.findZeroCrossings(curvature);
+        benchmark::DoNotOptimize(crossings.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_FindZeroCrossings)->RangeMultiplier(4)->Range(256, 65536);
+
+// ============================================================================
+// Matching
+// ============================================================================
+
+// Args: zero crossings per descriptor (both sides). Runs the TOED distance used for every
+// database comparison through Recognition::computeShapeDistance.
+static void BM_ToedDistance(benchmark::State &state)
+{
+    recognition::Recognition recognizer;
+    css::CSSImage a, b;
+    a.zeroCrossings = randomZeroCrossings(static_cast<int>(state.range(0)), 1);
+    b.zeroCrossings = randomZeroCrossings(static_cast<int>(state.range(0)), 2);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(recognizer.computeShapeDistance(a, b));
+    }
+}
+BENCHMARK(BM_ToedDistance)->RangeMultiplier(4)->Range(16, 1024);
+
+// ============================================================================
+// Contour extraction
+// ============================================================================
+
+// Args: image side in pixels. Images above ContourParams::maxDimension are downscaled first.
+static void BM_ExtractContour(benchmark::State &state)
+{
+    css::CSS css;
+    css::ExtractionContext ctx;
+    const cv::Mat image = starImage(static_cast<int>(state.range(0)));
+    for (auto _ : state)
+    {
+        std::vector<cv::Point> contour = css.extractContour(image, ctx);
+        benchmark::DoNotOptimize(contour.data());
+    }
+}
+BENCHMARK(BM_ExtractContour)->RangeMultiplier(2)->Range(256, 2048)->Unit(benchmark::kMillisecond);
+
+// ============================================================================
+// TOED
+// ============================================================================
+
+// Args: image side in pixels
+static void BM_TOEDConvolve(benchmark::State &state)
+{
+    const int size = static_cast<int>(state.range(0));
+    ThirdOrderEdgeDetectionCPU detector(size, size);
+    detector.preprocessing(starImage(size));
+    for (auto _ : state)
+    {
+        detector.convolve_img();
+    }
+}
+BENCHMARK(BM_TOEDConvolve)->RangeMultiplier(2)->Range(128, 512)->Unit(benchmark::kMillisecond);
+
+// Args: image side in pixels
+static void BM_TOEDNonMaximumSuppression(benchmark::State &state)
+{
+    const int size = static_cast<int>(state.range(0));
+    ThirdOrderEdgeDetectionCPU detector(size, size);
+    detector.preprocessing(starImage(size));
+    detector.convolve_img();
+    for (auto _ : state)
+    {
+        detector.toed_edges.clear(); // NMS appends to the edge list
+        benchmark::DoNotOptimize(detector.non_maximum_suppresion());
+    }
+    state.counters["edges"] = static_cast<double>(detector.toed_edges.size());
+}
+BENCHMARK(BM_TOEDNonMaximumSuppression)->RangeMultiplier(2)->Range(128, 512)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
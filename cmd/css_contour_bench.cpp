@@ -0,0 +1,184 @@
+#include "CSS.h"
+#include "Recognition.h"
+#include <opencv2/opencv.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// =======================================================================================================
+// css_contour_bench: Cost and accuracy of the threshold and TOED contour sources
+//
+// Renders anti-aliased filled ellipses with random axes and rotation, extracts the object contour
+// with each source and reports per-image extraction time, RMS distance of the contour to the
+// analytic ellipse, and the CSS distance between an ellipse and a rotated copy of itself (an
+// ideal extractor gives 0).
+//
+// Usage: css_contour_bench [num_images] [image_size]
+//
+// ChangeLogs
+//    Oct 18, 2026    Created to compare ContourSource::Threshold and ContourSource::TOED
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace
+{
+    struct Ellipse
+    {
+        cv::Point center;
+        cv::Size axes;
+        double angleDeg;
+    };
+
+    cv::Mat renderEllipse(const Ellipse &e, int size)
+    {
+        cv::Mat image(size, size, CV_8UC1, cv::Scalar(255));
+        cv::ellipse(image, e.center, e.axes, e.angleDeg, 0, 360, cv::Scalar(0), cv::FILLED, cv::LINE_AA);
+        return image;
+    }
+
+    std::vector<cv::Point2d> sampleEllipse(const Ellipse &e, int numPoints)
+    {
+        const double phi = e.angleDeg * CV_PI / 180.0;
+        std::vector<cv::Point2d> pts;
+        for (int i = 0; i < numPoints; i++)
+        {
+            const double t = 2.0 * CV_PI * i / numPoints;
+            const double x = e.axes.width * std::cos(t), y = e.axes.height * std::sin(t);
+            pts.push_back(cv::Point2d(e.center.x + x * std::cos(phi) - y * std::sin(phi),
+                                      e.center.y + x * std::sin(phi) + y * std::cos(phi)));
+        }
+        return pts;
+    }
+
+    // RMS distance from contour points to a dense sampling of the true boundary
+    double rmsError(const std::vector<cv::Point2d> &contour, const std::vector<cv::Point2d> &truth)
+    {
+        if (contour.empty())
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        double sum = 0.0;
+        for (const auto &p : contour)
+        {
+            double best = std::numeric_limits<double>::max();
+            for (const auto &q : truth)
+            {
+                const double dx = p.x - q.x, dy = p.y - q.y;
+                best = std::min(best, dx * dx + dy * dy);
+            }
+            sum += best;
+        }
+        return std::sqrt(sum / contour.size());
+    }
+
+    std::vector<cv::Point2d> toDouble(const std::vector<cv::Point> &contour)
+    {
+        std::vector<cv::Point2d> out;
+        for (const auto &pt : contour)
+        {
+            out.push_back(cv::Point2d(pt.x, pt.y));
+        }
+        return out;
+    }
+
+    struct SourceStats
+    {
+        std::string name;
+        double totalMs = 0.0;
+        double totalRms = 0.0;
+        double totalRotationDistance = 0.0;
+        int found = 0;
+    };
+
+    std::vector<cv::Point2d> extract(css::CSS &cssComputer, const cv::Mat &image, css::ContourSource source)
+    {
+        if (source == css::ContourSource::TOED)
+        {
+            return cssComputer.extractSubpixelContour(image);
+        }
+        return toDouble(cssComputer.extractContour(image));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const int numImages = argc >= 2 ? std::atoi(argv[1]) : 20;
+    const int size = argc >= 3 ? std::atoi(argv[2]) : 512;
+    const int resamplePoints = 256;
+
+    cv::RNG rng(12345);
+    recognition::Recognition distance; // only for computeShapeDistance
+
+    std::vector<SourceStats> stats(2);
+    stats[0].name = "threshold";
+    stats[1].name = "toed";
+    const css::ContourSource sources[2] = {css::ContourSource::Threshold, css::ContourSource::TOED};
+
+    for (int s = 0; s < 2; s++)
+    {
+        css::CSS cssComputer;
+        css::ContourParams params;
+        params.source = sources[s];
+        cssComputer.setContourParams(params);
+
+        // Warm-up allocates the TOED detector maps for this image size
+        extract(cssComputer, renderEllipse({cv::Point(size / 2, size / 2), cv::Size(size / 4, size / 6), 0}, size),
+                sources[s]);
+
+        cv::RNG local = rng;
+        for (int i = 0; i < numImages; i++)
+        {
+            Ellipse e;
+            e.center = cv::Point(size / 2 + local.uniform(-size / 16, size / 16),
+                                 size / 2 + local.uniform(-size / 16, size / 16));
+            e.axes = cv::Size(local.uniform(size / 8, size / 3), local.uniform(size / 10, size / 5));
+            e.angleDeg = local.uniform(0.0, 180.0);
+
+            Ellipse rotated = e;
+            rotated.angleDeg += 37.0;
+
+            const cv::Mat image = renderEllipse(e, size);
+            const cv::Mat imageRotated = renderEllipse(rotated, size);
+
+            const int64 start = cv::getTickCount();
+            std::vector<cv::Point2d> contour = extract(cssComputer, image, sources[s]);
+            stats[s].totalMs += (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+            std::vector<cv::Point2d> contourRotated = extract(cssComputer, imageRotated, sources[s]);
+            if (contour.empty() || contourRotated.empty())
+            {
+                continue;
+            }
+
+            stats[s].found++;
+            stats[s].totalRms += rmsError(contour, sampleEllipse(e, 4096));
+
+            css::CSSImage a = cssComputer.computeCSS(css::resampleContourArcLength(contour, resamplePoints));
+            css::CSSImage b = cssComputer.computeCSS(css::resampleContourArcLength(contourRotated, resamplePoints));
+            stats[s].totalRotationDistance += distance.computeShapeDistance(a, b);
+        }
+    }
+
+    std::cout << "\n=== Contour Source Benchmark (" << numImages << " ellipses, " << size << "x" << size << ") ==="
+              << std::endl;
+    std::cout << std::left << std::setw(12) << "source" << std::right << std::setw(10) << "found"
+              << std::setw(14) << "ms/image" << std::setw(14) << "rms (px)" << std::setw(18) << "rotation dist"
+              << std::endl;
+    for (const auto &s : stats)
+    {
+        const double n = std::max(1, s.found);
+        std::cout << std::left << std::setw(12) << s.name << std::right << std::setw(10) << s.found
+                  << std::setw(14) << std::fixed << std::setprecision(2) << s.totalMs / numImages
+                  << std::setw(14) << std::setprecision(3) << s.totalRms / n
+                  << std::setw(18) << std::setprecision(4) << s.totalRotationDistance / n << std::endl;
+    }
+
+    return 0;
+}
@@ -8,6 +8,7 @@ css::CSS *g_cssComputer = nullptr;
 std::vector<cv::Point> *g_originalContour = nullptr;
 cv::Mat *g_displayImage = nullptr;
 css::CSSImage *g_fullCSSImage = nullptr;
+cv::Mat *g_fullCSSVisual = nullptr; // drawn once from g_fullCSSImage
 int g_sigmaValue = 10; // Sigma * 10 for trackbar (0-1000 -> 0.0-100.0)
 double g_maxSigma = 100.0;
 int g_numScales = 50;
@@ -34,7 +35,7 @@ void updateVisualization(int, void *)
                 cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 2);
 
     // Create CSS visualization with current position marked
-    cv::Mat cssVis = g_fullCSSImage->image.clone();
+    cv::Mat cssVis = g_fullCSSVisual->clone();
 
     // Draw a horizontal line at current sigma level
     int cssHeight = cssVis.rows;
@@ -79,16 +80,6 @@ void interactiveMode(const std::string &imagePath)
         return;
     }
 
-    // Downscale large images
-    int maxDimension = 800;
-    if (img.rows > maxDimension || img.cols > maxDimension)
-    {
-        double scale = maxDimension / static_cast<double>(std::max(img.rows, img.cols));
-        cv::Size newSize(static_cast<int>(img.cols * scale), static_cast<int>(img.rows * scale));
-        cv::resize(img, img, newSize, 0, 0, cv::INTER_AREA);
-        std::cout << "Image downscaled to: " << img.cols << "x" << img.rows << std::endl;
-    }
-
     // Create CSS computer
     css::CSS cssComputer;
 
@@ -111,6 +102,8 @@ void interactiveMode(const std::string &imagePath)
     g_cssComputer = &cssComputer;
     g_originalContour = &contour;
     g_fullCSSImage = &cssImage;
+    cv::Mat cssVisual = cssComputer.visualizeCSSImage(cssImage);
+    g_fullCSSVisual = &cssVisual;
 
     cv::Mat displayImage;
     g_displayImage = &displayImage;
@@ -1,8 +1,29 @@
 #include "CSS.h"
+#include "ExecutionContext.h"
+#include "Profiling.h"
+#include "Tracing.h"
 #include "Recognition.h"
+#include "RecognitionServer.h"
+#include "ThreadPool.h"
+#include "Verification.h"
+#include "VideoPipeline.h"
+#include <cstdio>
+#include <cstdlib>
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
+#include <vector>
+
+// Threads and CPUs of every recognizer this process creates (--threads, --cpus, --partition, --nested)
+parallel::ExecutionContext gExecutionContext;
 
 void printUsage(const char *programName)
 {
@@ -11,17 +32,61 @@ void printUsage(const char *programName)
               << std::endl;
     std::cout << "Modes:" << std::endl;
     std::cout << "  1. demo <image>              - Demo CSS on single image with GIF output" << std::endl;
-    std::cout << "  2. build <database_dir>      - Build shape database from images" << std::endl;
-    std::cout << "  3. recognize <query_image>   - Recognize shape from query image" << std::endl;
-    std::cout << "  4. webcam                    - Live recognition from webcam" << std::endl;
+    std::cout << "  2. build <database_dir> [num_shards]" << std::endl;
+    std::cout << "                               - Build shape database from images" << std::endl;
+    std::cout << "  3. recognize <query_image> [database] [--stream|--all]" << std::endl;
+    std::cout << "                               - Recognize shape from query image" << std::endl;
+    std::cout << "                                 (--all: every object in the image)" << std::endl;
+    std::cout << "  4. recognize-batch <dir|list> [database] [--top K] [--json file] [--csv file] [--chunk N]" << std::endl;
+    std::cout << "                               - Recognize many images without GUI, report throughput" << std::endl;
+    std::cout << "  5. serve [database] [--socket path|--tcp port] [--workers N]" << std::endl;
+    std::cout << "                               - Keep the database loaded and answer socket requests" << std::endl;
+    std::cout << "  6. query <image> [--socket path|--tcp port] [--top K]" << std::endl;
+    std::cout << "                               - Send an image to a running server" << std::endl;
+    std::cout << "     reload <database> [--socket path|--tcp port]" << std::endl;
+    std::cout << "                               - Hot-swap the database of a running server" << std::endl;
+    std::cout << "  7. webcam                    - Live recognition from webcam" << std::endl;
+    std::cout << "  8. stream <camera|video> [database] [--headless] [--all-frames] [--no-reuse]" << std::endl;
+    std::cout << "                               - Continuous pipelined recognition of a video stream" << std::endl;
+    std::cout << "                                 (--all-frames: process every frame, never drop;" << std::endl;
+    std::cout << "                                  --no-reuse: recompute CSS on every frame)" << std::endl;
+    std::cout << "  9. verify [--seed S]         - Compare optimized kernels with their reference implementations" << std::endl;
+    std::cout << "\nOptions for every mode:" << std::endl;
+    std::cout << "  --profile                    - Print per-stage timings on exit (build with CSS_PROFILING=ON)" << std::endl;
+    std::cout << "  --profile-json <file>        - Write per-stage timings as JSON on exit" << std::endl;
+    std::cout << "  --trace <file>               - Record a Chrome trace of the run (build with CSS_TRACING=ON)" << std::endl;
+    std::cout << "  --threads N                  - Workers shared by recognition, CSS and TOED (default: one per CPU)" << std::endl;
+    std::cout << "  --cpus <list>                - Pin them to CPUs, e.g. 0-3,8" << std::endl;
+    std::cout << "  --partition I/N              - Use slice I of N disjoint CPU slices (co-located instances)" << std::endl;
+    std::cout << "  --nested serial|spread       - Loops inside a worker task run on it alone or on idle workers (default: spread)" << std::endl;
     std::cout << "\nExamples:" << std::endl;
     std::cout << "  " << programName << " demo shapes/apple.png" << std::endl;
     std::cout << "  " << programName << " build database/shapes/" << std::endl;
+    std::cout << "  " << programName << " build database/shapes/ 4      (writes shape_database.shards)" << std::endl;
     std::cout << "  " << programName << " recognize test.png" << std::endl;
+    std::cout << "  " << programName << " recognize test.png big_database.dat --stream" << std::endl;
+    std::cout << "  " << programName << " recognize tray.png --all" << std::endl;
+    std::cout << "  " << programName << " recognize-batch queries/ --json results.json --csv results.csv" << std::endl;
+    std::cout << "  " << programName << " serve shape_database.dat --socket /tmp/css.sock" << std::endl;
+    std::cout << "  " << programName << " query test.png --socket /tmp/css.sock" << std::endl;
     std::cout << "  " << programName << " webcam" << std::endl;
+    std::cout << "  " << programName << " stream 0" << std::endl;
+    std::cout << "  " << programName << " stream clip.mp4 --headless --all-frames" << std::endl;
+    std::cout << "  " << programName << " recognize-batch queries/ --profile-json stages.json" << std::endl;
+    std::cout << "  " << programName << " serve --socket /tmp/css0.sock --partition 0/2" << std::endl;
     std::cout << std::endl;
 }
 
+// Load a single-file database, or a sharded one when given a .shards manifest
+bool loadAnyDatabase(recognition::Recognition &recognizer, const std::string &dbPath)
+{
+    if (dbPath.size() > 7 && dbPath.compare(dbPath.size() - 7, 7, ".shards") == 0)
+    {
+        return recognizer.loadShardedDatabase(dbPath);
+    }
+    return recognizer.loadDatabase(dbPath);
+}
+
 void demoMode(const std::string &imagePath)
 {
     std::cout << "\n=== Demo Mode ===" << std::endl;
@@ -35,16 +100,6 @@ void demoMode(const std::string &imagePath)
         return;
     }
 
-    // Downscale large images (e.g., iPhone photos)
-    int maxDimension = 800; // Maximum width or height
-    if (img.rows > maxDimension || img.cols > maxDimension)
-    {
-        double scale = maxDimension / static_cast<double>(std::max(img.rows, img.cols));
-        cv::Size newSize(static_cast<int>(img.cols * scale), static_cast<int>(img.rows * scale));
-        cv::resize(img, img, newSize, 0, 0, cv::INTER_AREA);
-        std::cout << "Image downscaled to: " << img.cols << "x" << img.rows << std::endl;
-    }
-
     // Create CSS computer
     css::CSS cssComputer;
 
@@ -79,7 +134,8 @@ void demoMode(const std::string &imagePath)
 
     // Save CSS image
     std::string cssPath = imagePath.substr(0, imagePath.find_last_of('.')) + "_css.png";
-    cv::imwrite(cssPath, cssImg.image);
+    cv::Mat cssVisual = cssComputer.visualizeCSSImage(cssImg);
+    cv::imwrite(cssPath, cssVisual);
     std::cout << "CSS image saved to: " << cssPath << std::endl;
 
     // Save GIF
@@ -88,7 +144,7 @@ void demoMode(const std::string &imagePath)
 
     // Display results
     cv::imshow("Original", img);
-    cv::imshow("CSS Image", cssImg.image);
+    cv::imshow("CSS Image", cssVisual);
     if (!frames.empty())
     {
         cv::imshow("Final Frame", frames.back());
@@ -98,12 +154,12 @@ void demoMode(const std::string &imagePath)
     cv::waitKey(0);
 }
 
-void buildDatabaseMode(const std::string &databaseDir)
+void buildDatabaseMode(const std::string &databaseDir, int numShards)
 {
     std::cout << "\n=== Build Database Mode ===" << std::endl;
     std::cout << "Loading shapes from: " << databaseDir << std::endl;
 
-    recognition::Recognition recognizer;
+    recognition::Recognition recognizer(gExecutionContext);
 
     if (!recognizer.loadShapeDatabase(databaseDir))
     {
@@ -112,14 +168,66 @@ void buildDatabaseMode(const std::string &databaseDir)
     }
 
     // Save database
-    std::string dbPath = "shape_database.dat";
-    recognizer.saveDatabase(dbPath);
+    if (numShards > 1)
+    {
+        recognizer.saveShardedDatabase("shape_database.shards", numShards);
+    }
+    else
+    {
+        recognizer.saveDatabase("shape_database.dat");
+    }
 
     std::cout << "\nDatabase built successfully!" << std::endl;
     std::cout << "Total shapes: " << recognizer.getDatabaseSize() << std::endl;
 }
 
-void recognizeMode(const std::string &queryPath)
+void recognizeObjectsMode(recognition::Recognition &recognizer, const std::string &queryPath, const cv::Mat &query)
+{
+    std::cout << "Recognizing all objects..." << std::endl;
+    auto objects = recognizer.recognizeObjects(query, 5);
+    if (objects.empty())
+    {
+        std::cerr << "No objects found!" << std::endl;
+        return;
+    }
+
+    cv::Mat visualization;
+    if (query.channels() == 1)
+        cv::cvtColor(query, visualization, cv::COLOR_GRAY2BGR);
+    else
+        visualization = query.clone();
+
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        const auto &matches = objects[i].matches;
+        std::cout << "\nObject " << (i + 1) << " (" << objects[i].contour.size() << " contour points):" << std::endl;
+        for (size_t j = 0; j < matches.size(); j++)
+        {
+            std::cout << "  " << (j + 1) << ". " << matches[j].name
+                      << " (distance: " << matches[j].matchScore << ")" << std::endl;
+        }
+
+        cv::drawContours(visualization, std::vector<std::vector<cv::Point>>{objects[i].contour},
+                         -1, cv::Scalar(0, 255, 0), 2);
+        if (!matches.empty())
+        {
+            cv::Rect box = cv::boundingRect(objects[i].contour);
+            cv::putText(visualization, matches[0].name, cv::Point(box.x, std::max(box.y - 5, 15)),
+                        cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 0, 255), 2);
+        }
+    }
+
+    cv::imshow("Recognition Results", visualization);
+
+    std::string outPath = queryPath.substr(0, queryPath.find_last_of('.')) + "_objects.png";
+    cv::imwrite(outPath, visualization);
+    std::cout << "\nResults saved to: " << outPath << std::endl;
+
+    std::cout << "\nPress any key to exit..." << std::endl;
+    cv::waitKey(0);
+}
+
+void recognizeMode(const std::string &queryPath, const std::string &dbPath, bool stream, bool allObjects)
 {
     std::cout << "\n=== Recognition Mode ===" << std::endl;
     std::cout << "Query image: " << queryPath << std::endl;
@@ -132,19 +240,39 @@ void recognizeMode(const std::string &queryPath)
         return;
     }
 
-    // Load database
-    recognition::Recognition recognizer;
-    recognizer.loadDatabase("shape_database.dat");
+    recognition::Recognition recognizer(gExecutionContext);
+    std::vector<recognition::ShapeEntry> matches;
 
-    if (recognizer.getDatabaseSize() == 0)
+    if (stream)
     {
-        std::cerr << "Error: Database is empty! Run build mode first." << std::endl;
-        return;
+        // Scan the database file in chunks instead of loading it
+        std::cout << "Recognizing shape (streaming " << dbPath << ")..." << std::endl;
+        if (recognizer.useDatabaseParameters(dbPath))
+        {
+            matches = recognizer.recognizeShapeStreaming(dbPath, query, 5);
+        }
     }
+    else
+    {
+        // Load database
+        loadAnyDatabase(recognizer, dbPath);
+
+        if (recognizer.getDatabaseSize() == 0)
+        {
+            std::cerr << "Error: Database is empty! Run build mode first." << std::endl;
+            return;
+        }
 
-    // Recognize
-    std::cout << "Recognizing shape..." << std::endl;
-    auto matches = recognizer.recognizeShape(query, 5);
+        if (allObjects)
+        {
+            recognizeObjectsMode(recognizer, queryPath, query);
+            return;
+        }
+
+        // Recognize
+        std::cout << "Recognizing shape..." << std::endl;
+        matches = recognizer.recognizeShape(query, 5);
+    }
 
     if (matches.empty())
     {
@@ -172,12 +300,322 @@ void recognizeMode(const std::string &queryPath)
     cv::waitKey(0);
 }
 
+// Image files of a directory (sorted), or the paths listed one per line in a text file
+std::vector<std::string> collectQueryPaths(const std::string &source)
+{
+    namespace fs = std::filesystem;
+    std::vector<std::string> paths;
+    if (fs::is_directory(source))
+    {
+        for (const auto &entry : fs::directory_iterator(source))
+        {
+            std::string ext = entry.path().extension().string();
+            if (entry.is_regular_file() &&
+                (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tif"))
+            {
+                paths.push_back(entry.path().string());
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+
+    std::ifstream list(source);
+    std::string line;
+    while (std::getline(list, line))
+    {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (!line.empty() && line[0] != '#')
+        {
+            paths.push_back(line);
+        }
+    }
+    return paths;
+}
+
+std::string jsonEscape(const std::string &text)
+{
+    std::string out;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            out += buffer;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string csvEscape(const std::string &text)
+{
+    if (text.find_first_of(",\"\n") == std::string::npos)
+    {
+        return text;
+    }
+    std::string out = "\"";
+    for (char c : text)
+    {
+        out += c == '"' ? std::string("\"\"") : std::string(1, c);
+    }
+    return out + "\"";
+}
+
+// Nearest-rank percentile of ascending values
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+struct BatchQueryResult
+{
+    std::string path;
+    std::string status; // ok, load_failed or no_match
+    std::vector<recognition::ShapeEntry> matches;
+};
+
+void recognizeBatchMode(const std::string &source, const std::string &dbPath, int topK, size_t chunkSize,
+                        const std::string &jsonPath, const std::string &csvPath)
+{
+    typedef std::chrono::steady_clock Clock;
+    std::cout << "\n=== Batch Recognition Mode ===" << std::endl;
+
+    std::vector<std::string> paths = collectQueryPaths(source);
+    if (paths.empty())
+    {
+        std::cerr << "Error: No query images found in: " << source << std::endl;
+        return;
+    }
+
+    // The database is loaded once for all queries
+    recognition::Recognition recognizer(gExecutionContext);
+    if (!loadAnyDatabase(recognizer, dbPath) || recognizer.getDatabaseSize() == 0)
+    {
+        std::cerr << "Error: Database is empty! Run build mode first." << std::endl;
+        return;
+    }
+    recognizer.setResultCacheCapacity(0); // every query is distinct; caching only costs memory
+    std::cout << "Database loaded: " << recognizer.getDatabaseSize() << " shapes" << std::endl;
+    std::cout << "Queries: " << paths.size() << " (chunks of " << chunkSize << ")" << std::endl;
+
+    // Queries are decoded in parallel and recognized chunk by chunk with recognizeBatch, which
+    // extracts and describes the chunk in parallel and scores it with query/database tiling.
+    // Queries of a chunk finish together, so latency is measured per chunk, not per query.
+    // Decoding uses the threads and CPUs given by --threads/--cpus/--partition.
+    parallel::ThreadPool loaders(gExecutionContext);
+    std::vector<BatchQueryResult> results(paths.size());
+    std::vector<double> chunkLatencies;
+    const Clock::time_point batchStart = Clock::now();
+    for (size_t begin = 0; begin < paths.size(); begin += chunkSize)
+    {
+        const size_t end = std::min(paths.size(), begin + chunkSize);
+        const Clock::time_point chunkStart = Clock::now();
+
+        std::vector<cv::Mat> images(end - begin);
+        loaders.parallelFor(begin, end, 1, [&images, &paths, begin](size_t first, size_t last)
+                            {
+            for (size_t i = first; i < last; i++)
+            {
+                images[i - begin] = cv::imread(paths[i]);
+            } });
+
+        // Undecodable files are reported, not passed on
+        std::vector<cv::Mat> loaded;
+        std::vector<size_t> loadedIndex;
+        for (size_t i = begin; i < end; i++)
+        {
+            results[i].path = paths[i];
+            if (images[i - begin].empty())
+            {
+                results[i].status = "load_failed";
+                continue;
+            }
+            loaded.push_back(images[i - begin]);
+            loadedIndex.push_back(i);
+        }
+
+        std::vector<std::vector<recognition::ShapeEntry>> matches = recognizer.recognizeBatch(loaded, topK);
+        chunkLatencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - chunkStart).count());
+        for (size_t j = 0; j < loadedIndex.size(); j++)
+        {
+            BatchQueryResult &result = results[loadedIndex[j]];
+            result.matches = std::move(matches[j]);
+            result.status = result.matches.empty() ? "no_match" : "ok";
+        }
+    }
+    const double wallSeconds = std::chrono::duration<double>(Clock::now() - batchStart).count();
+
+    // Summary
+    size_t recognized = 0, failed = 0;
+    for (const auto &result : results)
+    {
+        recognized += result.status == "ok" ? 1 : 0;
+        failed += result.status == "load_failed" ? 1 : 0;
+    }
+    std::sort(chunkLatencies.begin(), chunkLatencies.end());
+    const double throughput = wallSeconds > 0.0 ? results.size() / wallSeconds : 0.0;
+
+    std::cout << "\nProcessed " << results.size() << " queries in " << wallSeconds << " s ("
+              << throughput << " queries/s)" << std::endl;
+    std::cout << "Recognized: " << recognized << ", no match: " << results.size() - recognized - failed
+              << ", unreadable: " << failed << std::endl;
+    std::cout << "Chunk latency (ms, " << chunkLatencies.size() << " chunks): p50 " << percentile(chunkLatencies, 50)
+              << ", p90 " << percentile(chunkLatencies, 90) << ", p99 " << percentile(chunkLatencies, 99)
+              << ", max " << chunkLatencies.back() << std::endl;
+
+    if (!jsonPath.empty())
+    {
+        std::ofstream json(jsonPath);
+        json << "{\n  \"database\": \"" << jsonEscape(dbPath) << "\",\n  \"topK\": " << topK
+             << ",\n  \"queries\": [";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const auto &result = results[i];
+            json << (i ? "," : "") << "\n    {\"path\": \"" << jsonEscape(result.path) << "\", \"status\": \""
+                 << result.status << "\", \"matches\": [";
+            for (size_t j = 0; j < result.matches.size(); j++)
+            {
+                json << (j ? ", " : "") << "{\"name\": \"" << jsonEscape(result.matches[j].name)
+                     << "\", \"distance\": " << result.matches[j].matchScore << "}";
+            }
+            json << "]}";
+        }
+        json << "\n  ],\n  \"summary\": {\"queries\": " << results.size() << ", \"recognized\": " << recognized
+             << ", \"load_failed\": " << failed << ", \"wall_seconds\": " << wallSeconds
+             << ", \"queries_per_second\": " << throughput << ", \"chunk_size\": " << chunkSize
+             << ", \"chunk_latency_ms\": {\"p50\": " << percentile(chunkLatencies, 50) << ", \"p90\": "
+             << percentile(chunkLatencies, 90) << ", \"p99\": " << percentile(chunkLatencies, 99) << ", \"max\": "
+             << chunkLatencies.back() << "}}\n}\n";
+        std::cout << "Results written to: " << jsonPath << std::endl;
+    }
+
+    if (!csvPath.empty())
+    {
+        std::ofstream csv(csvPath);
+        csv << "path,status,rank,name,distance\n";
+        for (const auto &result : results)
+        {
+            if (result.matches.empty())
+            {
+                csv << csvEscape(result.path) << "," << result.status << ",,,\n";
+            }
+            for (size_t j = 0; j < result.matches.size(); j++)
+            {
+                csv << csvEscape(result.path) << "," << result.status << "," << (j + 1) << ","
+                    << csvEscape(result.matches[j].name) << "," << result.matches[j].matchScore << "\n";
+            }
+        }
+        std::cout << "Results written to: " << csvPath << std::endl;
+    }
+}
+
+// Set from SIGINT/SIGTERM to shut the server down cleanly, and from SIGHUP to reload its database
+std::atomic<bool> gStopRequested(false);
+std::atomic<bool> gReloadRequested(false);
+
+void requestStop(int)
+{
+    gStopRequested = true;
+}
+
+void requestReload(int)
+{
+    gReloadRequested = true;
+}
+
+void serveMode(const std::string &dbPath, const recognition::ServerOptions &options)
+{
+    std::cout << "\n=== Serve Mode ===" << std::endl;
+
+    auto recognizer = std::make_shared<recognition::Recognition>(gExecutionContext);
+    if (!loadAnyDatabase(*recognizer, dbPath) || recognizer->getDatabaseSize() == 0)
+    {
+        std::cerr << "Error: Database is empty! Run build mode first." << std::endl;
+        return;
+    }
+    std::cout << "Database loaded: " << recognizer->getDatabaseSize() << " shapes" << std::endl;
+
+    recognition::RecognitionServer server(recognizer, options);
+    recognizer.reset(); // the server's handle owns it from here
+    if (!server.start())
+    {
+        std::cerr << "Error: Cannot start server" << std::endl;
+        return;
+    }
+
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    std::signal(SIGHUP, requestReload);
+    std::cout << "Listening on "
+              << (options.tcpPort > 0 ? "127.0.0.1:" + std::to_string(options.tcpPort) : options.socketPath)
+              << " (Ctrl+C to stop, SIGHUP to reload " << dbPath << ")" << std::endl;
+    while (!gStopRequested)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        if (gReloadRequested.exchange(false) && !server.requestReload(dbPath))
+        {
+            std::cerr << "Reload already in progress" << std::endl;
+        }
+    }
+
+    server.stop();
+    std::cout << "\nServed " << server.requestsServed() << " requests" << std::endl;
+}
+
+// Ask a running server to swap in another database without interrupting its queries
+void reloadMode(const std::string &dbPath, const recognition::ServerOptions &endpoint)
+{
+    std::string response;
+    if (!recognition::sendRecognitionRequest(endpoint, recognition::RequestReload, 0,
+                                             std::vector<uint8_t>(dbPath.begin(), dbPath.end()), response))
+    {
+        std::cerr << "Error: Request failed (is the server running?)" << std::endl;
+        return;
+    }
+    std::cout << response << std::endl;
+}
+
+void queryMode(const std::string &imagePath, const recognition::ServerOptions &endpoint, int topK)
+{
+    // The encoded file is sent as is; the server decodes it
+    std::ifstream file(imagePath, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Error: Cannot read query image: " << imagePath << std::endl;
+        return;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::string response;
+    if (!recognition::sendRecognitionRequest(endpoint, recognition::RequestImage, topK, bytes, response))
+    {
+        std::cerr << "Error: Request failed (is the server running?)" << std::endl;
+        return;
+    }
+    std::cout << response << std::endl;
+}
+
 void webcamMode()
 {
     std::cout << "\n=== Webcam Mode ===" << std::endl;
 
     // Load database
-    recognition::Recognition recognizer;
+    recognition::Recognition recognizer(gExecutionContext);
     recognizer.loadDatabase("shape_database.dat");
 
     if (recognizer.getDatabaseSize() == 0)
@@ -202,6 +640,7 @@ void webcamMode()
 
     cv::Mat frame, gray;
     css::CSS cssComputer;
+    css::ExtractionContext extractionCtx; // reused across frames
 
     while (true)
     {
@@ -213,7 +652,7 @@ void webcamMode()
         cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
 
         // Try to extract contour for preview
-        auto contour = cssComputer.extractContour(gray);
+        auto contour = cssComputer.extractContour(gray, extractionCtx);
         cv::Mat display = frame.clone();
 
         if (!contour.empty())
@@ -244,6 +683,10 @@ void webcamMode()
                 std::cout << "Best match: " << matches[0].name
                           << " (distance: " << matches[0].matchScore << ")" << std::endl;
 
+                auto stats = recognizer.getCacheStats();
+                std::cout << "Result cache: " << stats.hits() << " hits, " << stats.misses
+                          << " misses (hit rate " << stats.hitRate() * 100.0 << "%)" << std::endl;
+
                 cv::Mat visualization = recognizer.visualizeMatches(frame, matches, 3);
                 cv::imshow("Match Results", visualization);
             }
@@ -262,8 +705,229 @@ void webcamMode()
     cv::destroyAllWindows();
 }
 
+// Format per-stage latencies of a frame, e.g. for the overlay
+std::string formatTimings(const recognition::StageTimings &t)
+{
+    char buffer[160];
+    std::snprintf(buffer, sizeof(buffer), "extract %.1f  css %.1f  match %.1f  latency %.1f ms",
+                  t.extract, t.describe, t.match, t.latency);
+    return buffer;
+}
+
+void streamMode(const std::string &source, const std::string &dbPath, bool headless, bool allFrames, bool reuse)
+{
+    std::cout << "\n=== Stream Mode ===" << std::endl;
+
+    recognition::Recognition recognizer(gExecutionContext);
+    if (!loadAnyDatabase(recognizer, dbPath) || recognizer.getDatabaseSize() == 0)
+    {
+        std::cerr << "Error: Database is empty! Run build mode first." << std::endl;
+        return;
+    }
+    std::cout << "Database loaded: " << recognizer.getDatabaseSize() << " shapes" << std::endl;
+
+    recognition::PipelineOptions options;
+    options.dropStaleFrames = !allFrames;
+    options.paceToFrameRate = !allFrames;
+    options.temporalReuse = reuse;
+
+    recognition::VideoPipeline pipeline(recognizer, options);
+    if (!pipeline.start(source))
+    {
+        std::cerr << "Error: Cannot open video source: " << source << std::endl;
+        return;
+    }
+
+    if (!headless)
+    {
+        std::cout << "\nPress 'q' or ESC to quit" << std::endl;
+    }
+
+    recognition::FrameResult result;
+    while (pipeline.nextResult(result))
+    {
+        const std::string best = result.matches.empty()
+                                     ? std::string("-")
+                                     : result.matches[0].name + " (" + std::to_string(result.matches[0].matchScore) + ")";
+
+        if (headless)
+        {
+            std::cout << "frame " << result.frameIndex << ": " << best << (result.reused ? " (reused)" : "")
+                      << "  [" << formatTimings(result.timings) << "]" << std::endl;
+            continue;
+        }
+
+        cv::Mat display = result.frame.clone();
+        if (result.found)
+        {
+            cv::drawContours(display, std::vector<std::vector<cv::Point>>{result.query.contour},
+                             -1, cv::Scalar(0, 255, 0), 2);
+        }
+
+        const recognition::PipelineStats stats = pipeline.stats();
+        cv::putText(display, "Match: " + best, cv::Point(10, 30),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 0), 2);
+        cv::putText(display, formatTimings(stats.last), cv::Point(10, 60),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 1);
+        cv::putText(display, "dropped " + std::to_string(stats.framesDropped) + ", reused " +
+                                 std::to_string(stats.framesReused) + " / " + std::to_string(stats.framesCaptured) + " frames",
+                    cv::Point(10, 85), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 1);
+
+        cv::imshow("Stream - CSS Recognition", display);
+        int key = cv::waitKey(1);
+        if (key == 'q' || key == 27)
+        {
+            break;
+        }
+    }
+
+    pipeline.stop();
+    if (!headless)
+    {
+        cv::destroyAllWindows();
+    }
+
+    const recognition::PipelineStats stats = pipeline.stats();
+    std::cout << "\nFrames: " << stats.framesCaptured << " captured, " << stats.framesProcessed
+              << " processed, " << stats.framesDropped << " dropped, " << stats.framesReused
+              << " reused" << std::endl;
+    std::cout << "Mean stage times: capture " << stats.mean.capture << " ms, " << formatTimings(stats.mean) << std::endl;
+}
+
+// Golden-output check of the optimized kernels; false if any array exceeds its tolerance
+bool verifyMode(unsigned seed)
+{
+    std::cout << "\n=== Kernel Verification (seed " << seed << ") ===" << std::endl;
+    const verification::VerificationReport report = verification::verifyKernels(seed);
+    std::cout << report.format();
+    std::cout << (report.passed() ? "All kernels match their reference" : "Kernel verification FAILED") << std::endl;
+    return report.passed();
+}
+
+// Emits the profiling report when main returns, whichever mode ran and however it ended
+class ProfileReporter
+{
+public:
+    ProfileReporter(bool report, const std::string &jsonPath) : report_(report), jsonPath_(jsonPath)
+    {
+        if ((report_ || !jsonPath_.empty()) && !profiling::compiledIn())
+        {
+            std::cerr << "Warning: built without profiling, reconfigure with -DCSS_PROFILING=ON" << std::endl;
+        }
+    }
+
+    ~ProfileReporter()
+    {
+        if (report_)
+        {
+            std::cout << "\n=== Stage timings ===\n"
+                      << profiling::formatReport() << std::flush;
+        }
+        if (!jsonPath_.empty())
+        {
+            std::ofstream out(jsonPath_);
+            out << profiling::formatJson();
+            std::cout << "Stage timings written to: " << jsonPath_ << std::endl;
+        }
+    }
+
+private:
+    bool report_;
+    std::string jsonPath_;
+};
+
+// Records a trace for the lifetime of main; open the file in chrome://tracing or ui.perfetto.dev
+class TraceRecorder
+{
+public:
+    explicit TraceRecorder(const std::string &tracePath) : tracePath_(tracePath)
+    {
+        if (tracePath_.empty())
+        {
+            return;
+        }
+        if (!tracing::compiledIn())
+        {
+            std::cerr << "Warning: built without tracing, reconfigure with -DCSS_TRACING=ON" << std::endl;
+        }
+        tracing::start();
+    }
+
+    ~TraceRecorder()
+    {
+        if (tracePath_.empty())
+        {
+            return;
+        }
+        tracing::stop();
+        if (tracing::writeChromeTrace(tracePath_))
+        {
+            std::cout << "Trace (" << tracing::eventCount() << " events) written to: " << tracePath_ << std::endl;
+        }
+    }
+
+private:
+    std::string tracePath_;
+};
+
 int main(int argc, char **argv)
 {
+    // Profiling, tracing and threading options apply to every mode; strip them before the mode
+    // arguments are parsed
+    bool profileReport = false;
+    std::string profileJson;
+    std::string tracePath;
+    std::vector<char *> args;
+    for (int i = 0; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--profile")
+            profileReport = true;
+        else if (arg == "--profile-json" && i + 1 < argc)
+            profileJson = argv[++i];
+        else if (arg == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            const int threads = std::atoi(argv[++i]);
+            gExecutionContext.numThreads = static_cast<size_t>(std::max(0, threads));
+        }
+        else if (arg == "--cpus" && i + 1 < argc)
+        {
+            if (!parallel::parseCpuList(argv[++i], gExecutionContext.cpus))
+                return 1;
+        }
+        else if (arg == "--partition" && i + 1 < argc)
+        {
+            unsigned index = 0, count = 0;
+            if (std::sscanf(argv[++i], "%u/%u", &index, &count) != 2 || count == 0 || index >= count)
+            {
+                std::cerr << "Error: --partition expects I/N with I < N, got " << argv[i] << std::endl;
+                return 1;
+            }
+            const parallel::ExecutionContext slice = parallel::ExecutionContext::partition(index, count);
+            gExecutionContext.cpus = slice.cpus;
+            gExecutionContext.numThreads = slice.numThreads;
+        }
+        else if (arg == "--nested" && i + 1 < argc)
+        {
+            const std::string policy = argv[++i];
+            if (policy != "serial" && policy != "spread")
+            {
+                std::cerr << "Error: --nested expects serial or spread, got " << policy << std::endl;
+                return 1;
+            }
+            gExecutionContext.nested = policy == "serial" ? parallel::NestedPolicy::Serial : parallel::NestedPolicy::Spread;
+        }
+        else
+            args.push_back(argv[i]);
+    }
+    argc = static_cast<int>(args.size());
+    args.push_back(nullptr);
+    argv = args.data();
+    ProfileReporter profileReporter(profileReport, profileJson);
+    TraceRecorder traceRecorder(tracePath);
+
     if (argc < 2)
     {
         printUsage(argv[0]);
@@ -280,16 +944,109 @@ int main(int argc, char **argv)
         }
         else if (mode == "build" && argc >= 3)
         {
-            buildDatabaseMode(argv[2]);
+            buildDatabaseMode(argv[2], argc >= 4 ? std::stoi(argv[3]) : 1);
         }
         else if (mode == "recognize" && argc >= 3)
         {
-            recognizeMode(argv[2]);
+            std::string dbPath = "shape_database.dat";
+            bool stream = false;
+            bool allObjects = false;
+            for (int i = 3; i < argc; i++)
+            {
+                std::string arg = argv[i];
+                if (arg == "--stream")
+                    stream = true;
+                else if (arg == "--all")
+                    allObjects = true;
+                else
+                    dbPath = arg;
+            }
+            recognizeMode(argv[2], dbPath, stream, allObjects);
+        }
+        else if (mode == "recognize-batch" && argc >= 3)
+        {
+            std::string dbPath = "shape_database.dat";
+            std::string jsonPath, csvPath;
+            int topK = 5;
+            size_t chunkSize = 64;
+            for (int i = 3; i < argc; i++)
+            {
+                std::string arg = argv[i];
+                if (arg == "--top" && i + 1 < argc)
+                    topK = std::stoi(argv[++i]);
+                else if (arg == "--json" && i + 1 < argc)
+                    jsonPath = argv[++i];
+                else if (arg == "--csv" && i + 1 < argc)
+                    csvPath = argv[++i];
+                else if (arg == "--chunk" && i + 1 < argc)
+                    chunkSize = std::max(1, std::stoi(argv[++i]));
+                else
+                    dbPath = arg;
+            }
+            if (jsonPath.empty() && csvPath.empty())
+                jsonPath = "batch_results.json";
+            recognizeBatchMode(argv[2], dbPath, topK, chunkSize, jsonPath, csvPath);
+        }
+        else if (mode == "serve" || ((mode == "query" || mode == "reload") && argc >= 3))
+        {
+            recognition::ServerOptions options;
+            std::string dbPath = "shape_database.dat";
+            int topK = 5;
+            for (int i = mode == "serve" ? 2 : 3; i < argc; i++)
+            {
+                std::string arg = argv[i];
+                if (arg == "--socket" && i + 1 < argc)
+                    options.socketPath = argv[++i];
+                else if (arg == "--tcp" && i + 1 < argc)
+                    options.tcpPort = std::stoi(argv[++i]);
+                else if (arg == "--workers" && i + 1 < argc)
+                    options.numWorkers = std::stoul(argv[++i]);
+                else if (arg == "--top" && i + 1 < argc)
+                    topK = std::stoi(argv[++i]);
+                else
+                    dbPath = arg;
+            }
+            if (mode == "serve")
+                serveMode(dbPath, options);
+            else if (mode == "reload")
+                reloadMode(argv[2], options);
+            else
+                queryMode(argv[2], options, topK);
+        }
+        else if (mode == "verify")
+        {
+            unsigned seed = 1;
+            for (int i = 2; i + 1 < argc; i++)
+            {
+                if (std::string(argv[i]) == "--seed")
+                    seed = static_cast<unsigned>(std::stoul(argv[++i]));
+            }
+            return verifyMode(seed) ? 0 : 1;
         }
         else if (mode == "webcam")
         {
             webcamMode();
         }
+        else if (mode == "stream" && argc >= 3)
+        {
+            std::string dbPath = "shape_database.dat";
+            bool headless = false;
+            bool allFrames = false;
+            bool reuse = true;
+            for (int i = 3; i < argc; i++)
+            {
+                std::string arg = argv[i];
+                if (arg == "--headless")
+                    headless = true;
+                else if (arg == "--all-frames")
+                    allFrames = true;
+                else if (arg == "--no-reuse")
+                    reuse = false;
+                else
+                    dbPath = arg;
+            }
+            streamMode(argv[2], dbPath, headless, allFrames, reuse);
+        }
         else
         {
             std::cerr << "Error: Invalid mode or missing arguments!" << std::endl;
@@ -0,0 +1,126 @@
+#include "Recognition.h"
+#include "RecognitionServer.h"
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// =======================================================================================================
+// css_reload_check: A server reload of a bad file must leave the served database untouched
+//
+// Builds a small database of ellipses, then asks a RecognitionServer (not listening; reloads run
+// on its own thread regardless) to reload files that are not databases: a PNG header, plain text,
+// a truncated database and a missing path. Each must fail without taking the process down and
+// without publishing a new database version. A final reload of the intact database must be
+// published. Exits non-zero if any check fails; registered as a ctest test.
+//
+// Usage: css_reload_check [scratch_dir]
+//
+// ChangeLogs
+//    Oct 18, 2026    Created to keep reloads of bad files from crashing the server
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace
+{
+    std::vector<cv::Point> ellipse(double a, double b)
+    {
+        std::vector<cv::Point> contour;
+        for (int i = 0; i < 200; i++)
+        {
+            const double t = 2.0 * CV_PI * i / 200;
+            cv::Point p(cvRound(300.0 + a * std::cos(t)), cvRound(300.0 + b * std::sin(t)));
+            if (contour.empty() || contour.back() != p)
+            {
+                contour.push_back(p);
+            }
+        }
+        return contour;
+    }
+
+    void writeFile(const std::string &path, const std::string &bytes)
+    {
+        std::ofstream ofs(path, std::ios::binary);
+        ofs.write(bytes.data(), bytes.size());
+    }
+
+    std::string readFile(const std::string &path)
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+
+    // Requests a reload and waits until the reload thread has finished with it
+    bool reload(recognition::RecognitionServer &server, const std::string &path)
+    {
+        if (!server.requestReload(path))
+        {
+            return false;
+        }
+        while (server.reloadInProgress())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const std::string dir = argc > 1 ? argv[1] : "/tmp";
+    const std::string database = dir + "/css_reload_check.dat";
+
+    auto recognizer = std::make_shared<recognition::Recognition>();
+    std::vector<std::string> names;
+    std::vector<std::vector<cv::Point>> contours;
+    for (int i = 0; i < 8; i++)
+    {
+        names.push_back("ellipse" + std::to_string(i));
+        contours.push_back(ellipse(100.0, 30.0 + 10.0 * i));
+    }
+    recognizer->addShapes(names, contours);
+    recognizer->saveDatabase(database);
+
+    recognition::RecognitionServer server(recognizer);
+    recognizer.reset();
+
+    const std::string intact = readFile(database);
+    const std::vector<std::pair<std::string, std::string>> badFiles = {
+        {"png", std::string("\x89PNG\r\n\x1a\n\0\0\0\rIHDR\0\0\x01\0\0\0\x01\0\x08\x06\0\0\0", 29)},
+        {"text", "name,x,y\napple,1,2\npear,3,4\n"},
+        {"truncated", intact.substr(0, intact.size() / 2)},
+    };
+
+    int failures = 0;
+    auto check = [&](const std::string &what, bool ok)
+    {
+        std::cout << (ok ? "ok    " : "FAIL  ") << what << std::endl;
+        failures += ok ? 0 : 1;
+    };
+
+    for (const auto &bad : badFiles)
+    {
+        const std::string path = dir + "/css_reload_check." + bad.first;
+        writeFile(path, bad.second);
+        check("reload of " + bad.first + " file", reload(server, path));
+        check("  database unchanged", server.databaseVersion() == 0);
+        std::remove(path.c_str());
+    }
+    check("reload of missing file", reload(server, dir + "/css_reload_check.missing"));
+    check("  database unchanged", server.databaseVersion() == 0);
+
+    check("reload of intact database", reload(server, database));
+    check("  published as version 1", server.databaseVersion() == 1);
+    std::remove(database.c_str());
+
+    std::cout << (failures == 0 ? "PASSED" : "FAILED") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,366 @@
+#include "Recognition.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// =======================================================================================================
+// css_throughput_bench: End-to-end recognition throughput on procedurally generated databases
+//
+// Generates closed silhouettes from three families (superellipses, star polygons and blobs with
+// random low-frequency harmonics), builds databases of the requested sizes and measures build time,
+// memory, and the latency percentiles, queries per second and top-1 hit rate of queries made from
+// rotated, rescaled, noisy and start-shifted copies of database shapes, for each worker count.
+// Shape i depends only on the seed and i, so runs with the same arguments are comparable.
+//
+// Usage: css_throughput_bench [--sizes 1000,10000,100000] [--threads 1,2,4,8] [--queries 200]
+//                             [--top 5] [--seed 1] [--json results.json]
+//
+// ChangeLogs
+//    Oct 18, 2026    Created to measure how recognition scales with database size
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const int kCurvePoints = 256; // samples of the generated outline, before rasterization
+
+    // Outline of shape `index` centered at the origin with a radius of roughly 100 px
+    std::vector<cv::Point2d> generateShape(unsigned seed, size_t index)
+    {
+        std::mt19937 rng(seed * 1000003u + static_cast<unsigned>(index));
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::vector<cv::Point2d> curve(kCurvePoints);
+
+        switch (index % 3)
+        {
+        case 0:
+        {
+            // Superellipse |x/a|^n + |y/b|^n = 1
+            const double a = 60.0 + 60.0 * unit(rng), b = 40.0 + 80.0 * unit(rng);
+            const double n = 0.6 + 4.4 * unit(rng);
+            for (int i = 0; i < kCurvePoints; i++)
+            {
+                const double t = 2.0 * CV_PI * i / kCurvePoints;
+                const double c = std::cos(t), s = std::sin(t);
+                curve[i] = cv::Point2d(a * std::copysign(std::pow(std::abs(c), 2.0 / n), c),
+                                       b * std::copysign(std::pow(std::abs(s), 2.0 / n), s));
+            }
+            break;
+        }
+        case 1:
+        {
+            // Star polygon, sampled uniformly along its edges
+            const int tips = 3 + static_cast<int>(10 * unit(rng));
+            const double inner = 0.3 + 0.5 * unit(rng);
+            std::vector<cv::Point2d> vertices;
+            for (int v = 0; v < 2 * tips; v++)
+            {
+                const double r = 100.0 * (v % 2 == 0 ? 1.0 : inner);
+                const double t = CV_PI * v / tips;
+                vertices.emplace_back(r * std::cos(t), r * std::sin(t));
+            }
+            for (int i = 0; i < kCurvePoints; i++)
+            {
+                const double u = static_cast<double>(i) * vertices.size() / kCurvePoints;
+                const size_t v = static_cast<size_t>(u);
+                const double f = u - v;
+                curve[i] = vertices[v] * (1.0 - f) + vertices[(v + 1) % vertices.size()] * f;
+            }
+            break;
+        }
+        default:
+        {
+            // Blob: circle perturbed by random harmonics 2..7
+            double amp[8], phase[8];
+            for (int h = 2; h < 8; h++)
+            {
+                amp[h] = 0.3 / h * unit(rng);
+                phase[h] = 2.0 * CV_PI * unit(rng);
+            }
+            for (int i = 0; i < kCurvePoints; i++)
+            {
+                const double t = 2.0 * CV_PI * i / kCurvePoints;
+                double r = 1.0;
+                for (int h = 2; h < 8; h++)
+                {
+                    r += amp[h] * std::cos(h * t + phase[h]);
+                }
+                curve[i] = cv::Point2d(100.0 * r * std::cos(t), 100.0 * r * std::sin(t));
+            }
+            break;
+        }
+        }
+        return curve;
+    }
+
+    // Rotate, scale, jitter and shift the starting point of an outline, then put it on the pixel grid
+    std::vector<cv::Point> toContour(const std::vector<cv::Point2d> &curve, double angle, double scale,
+                                     double noise, size_t startShift, std::mt19937 &rng)
+    {
+        std::normal_distribution<double> jitter(0.0, noise > 0.0 ? noise : 1.0);
+        const double c = std::cos(angle) * scale, s = std::sin(angle) * scale;
+        std::vector<cv::Point> contour;
+        contour.reserve(curve.size());
+        for (size_t i = 0; i < curve.size(); i++)
+        {
+            const cv::Point2d &p = curve[(i + startShift) % curve.size()];
+            double x = 300.0 + c * p.x - s * p.y, y = 300.0 + s * p.x + c * p.y;
+            if (noise > 0.0)
+            {
+                x += jitter(rng);
+                y += jitter(rng);
+            }
+            cv::Point q(cvRound(x), cvRound(y));
+            if (contour.empty() || contour.back() != q)
+            {
+                contour.push_back(q);
+            }
+        }
+        return contour;
+    }
+
+    // Restart the peak resident memory (VmHWM) from the current RSS, so each size reports its own
+    // peak rather than the largest one so far; false if the kernel does not support it
+    bool resetPeakMemory()
+    {
+        std::ofstream clearRefs("/proc/self/clear_refs");
+        clearRefs << "5";
+        clearRefs.flush();
+        return static_cast<bool>(clearRefs);
+    }
+
+    // Resident and peak resident memory in MB, from /proc
+    void readMemory(double &rssMb, double &peakMb)
+    {
+        rssMb = peakMb = 0.0;
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            std::istringstream fields(line);
+            std::string key;
+            double kb = 0.0;
+            fields >> key >> kb;
+            if (key == "VmRSS:")
+                rssMb = kb / 1024.0;
+            else if (key == "VmHWM:")
+                peakMb = kb / 1024.0;
+        }
+    }
+
+    double percentile(const std::vector<double> &sorted, double p)
+    {
+        if (sorted.empty())
+        {
+            return 0.0;
+        }
+        const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+    std::vector<size_t> parseList(const std::string &text)
+    {
+        std::vector<size_t> values;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ','))
+        {
+            if (!item.empty())
+            {
+                values.push_back(std::stoul(item));
+            }
+        }
+        return values;
+    }
+
+    struct QueryRun
+    {
+        size_t threads;
+        double qps, p50, p90, p99, maxMs, top1;
+    };
+
+    struct SizeRun
+    {
+        size_t databaseSize;
+        double buildSeconds, rssMb, peakMb;
+        std::vector<QueryRun> queries;
+    };
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<size_t> sizes = {1000, 10000, 100000};
+    std::vector<size_t> threadCounts;
+    size_t numQueries = 200;
+    int topK = 5;
+    unsigned seed = 1;
+    std::string jsonPath;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+        if (arg == "--sizes")
+            sizes = parseList(argv[++i]);
+        else if (arg == "--threads")
+            threadCounts = parseList(argv[++i]);
+        else if (arg == "--queries")
+            numQueries = std::stoul(argv[++i]);
+        else if (arg == "--top")
+            topK = std::stoi(argv[++i]);
+        else if (arg == "--seed")
+            seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (arg == "--json")
+            jsonPath = argv[++i];
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    // Default: powers of two up to the core count
+    if (threadCounts.empty())
+    {
+        const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t t = 1; t < cores; t *= 2)
+        {
+            threadCounts.push_back(t);
+        }
+        threadCounts.push_back(cores);
+    }
+
+    std::vector<SizeRun> runs;
+    for (size_t size : sizes)
+    {
+        SizeRun run;
+        run.databaseSize = size;
+        std::cout << "\n=== Database of " << size << " shapes ===" << std::endl;
+
+        // Build in chunks so generated contours do not pile up next to the database
+        const bool peakIsPerSize = resetPeakMemory();
+        recognition::Recognition recognizer;
+        recognizer.setResultCacheCapacity(0); // every query must be scored
+        const size_t chunk = 10000;
+        std::mt19937 buildRng(seed);
+        const Clock::time_point buildStart = Clock::now();
+        for (size_t begin = 0; begin < size; begin += chunk)
+        {
+            const size_t end = std::min(size, begin + chunk);
+            std::vector<std::string> names;
+            std::vector<std::vector<cv::Point>> contours;
+            for (size_t i = begin; i < end; i++)
+            {
+                names.push_back("shape" + std::to_string(i));
+                contours.push_back(toContour(generateShape(seed, i), 0.0, 1.0, 0.0, 0, buildRng));
+            }
+            recognizer.addShapes(names, contours);
+        }
+        run.buildSeconds = std::chrono::duration<double>(Clock::now() - buildStart).count();
+        readMemory(run.rssMb, run.peakMb);
+        if (!peakIsPerSize)
+        {
+            run.peakMb = 0.0; // VmHWM would include earlier, larger sizes
+        }
+        std::cout << "Build: " << run.buildSeconds << " s (" << size / run.buildSeconds << " shapes/s), RSS "
+                  << run.rssMb << " MB, peak "
+                  << (peakIsPerSize ? std::to_string(run.peakMb) + " MB" : std::string("n/a")) << std::endl;
+
+        // Queries: transformed copies of random database shapes, the same set for every thread count
+        std::mt19937 queryRng(seed + 1);
+        std::uniform_int_distribution<size_t> pick(0, size - 1);
+        std::uniform_real_distribution<double> angle(0.0, 2.0 * CV_PI), scale(0.7, 1.4);
+        std::uniform_int_distribution<size_t> shift(0, kCurvePoints - 1);
+        std::vector<std::vector<cv::Point>> queries;
+        std::vector<std::string> expected;
+        for (size_t q = 0; q < numQueries; q++)
+        {
+            const size_t target = pick(queryRng);
+            queries.push_back(toContour(generateShape(seed, target), angle(queryRng), scale(queryRng), 0.5,
+                                        shift(queryRng), queryRng));
+            expected.push_back("shape" + std::to_string(target));
+        }
+
+        std::cout << std::setw(8) << "threads" << std::setw(12) << "qps" << std::setw(10) << "p50 ms"
+                  << std::setw(10) << "p90 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "top-1" << std::endl;
+        for (size_t threads : threadCounts)
+        {
+            recognizer.setNumThreads(threads);
+
+            std::vector<double> latencies;
+            size_t hits = 0;
+            const Clock::time_point start = Clock::now();
+            for (size_t q = 0; q < queries.size(); q++)
+            {
+                const Clock::time_point queryStart = Clock::now();
+                std::vector<recognition::ShapeEntry> matches = recognizer.recognizeShape(queries[q], topK);
+                latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - queryStart).count());
+                hits += !matches.empty() && matches[0].name == expected[q] ? 1 : 0;
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::sort(latencies.begin(), latencies.end());
+
+            QueryRun result;
+            result.threads = threads;
+            result.qps = seconds > 0.0 ? queries.size() / seconds : 0.0;
+            result.p50 = percentile(latencies, 50);
+            result.p90 = percentile(latencies, 90);
+            result.p99 = percentile(latencies, 99);
+            result.maxMs = latencies.empty() ? 0.0 : latencies.back();
+            result.top1 = queries.empty() ? 0.0 : static_cast<double>(hits) / queries.size();
+            run.queries.push_back(result);
+
+            std::cout << std::setw(8) << threads << std::setw(12) << std::fixed << std::setprecision(1) << result.qps
+                      << std::setw(10) << std::setprecision(2) << result.p50 << std::setw(10) << result.p90
+                      << std::setw(10) << result.p99 << std::setw(10) << result.top1 << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+            std::cout << std::setprecision(6);
+        }
+        runs.push_back(run);
+    }
+
+    if (!jsonPath.empty())
+    {
+        std::ofstream json(jsonPath);
+        json << "{\n  \"seed\": " << seed << ", \"queries\": " << numQueries << ", \"topK\": " << topK
+             << ",\n  \"runs\": [";
+        for (size_t r = 0; r < runs.size(); r++)
+        {
+            const SizeRun &run = runs[r];
+            json << (r ? "," : "") << "\n    {\"database_size\": " << run.databaseSize
+                 << ", \"build_seconds\": " << run.buildSeconds
+                 << ", \"build_shapes_per_second\": " << run.databaseSize / run.buildSeconds
+                 << ", \"rss_mb\": " << run.rssMb << ", \"peak_rss_mb\": " << run.peakMb << ", \"queries\": [";
+            for (size_t q = 0; q < run.queries.size(); q++)
+            {
+                const QueryRun &query = run.queries[q];
+                json << (q ? "," : "") << "\n      {\"threads\": " << query.threads << ", \"qps\": " << query.qps
+                     << ", \"latency_ms\": {\"p50\": " << query.p50 << ", \"p90\": " << query.p90
+                     << ", \"p99\": " << query.p99 << ", \"max\": " << query.maxMs << "}, \"top1\": " << query.top1
+                     << "}";
+            }
+            json << "]}";
+        }
+        json << "\n  ]\n}\n";
+        std::cout << "\nResults written to: " << jsonPath << std::endl;
+    }
+
+    return 0;
+}
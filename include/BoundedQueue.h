@@ -0,0 +1,128 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// =======================================================================================================
+// BoundedQueue: Fixed-capacity blocking queue connecting pipeline stages
+//
+// When full, push either waits for room or, in drop-oldest mode, discards the oldest item so a
+// slow consumer always sees the most recent data (stale video frames are skipped, not queued).
+// close() ends the stream: pop drains what is left and then returns false. reopen() starts a new one.
+//
+// ChangeLogs
+//    Oct 18, 2026    Created for the video recognition pipeline
+//    Oct 18, 2026    reopen() so a stopped pipeline can be started again
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace parallel
+{
+
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        BoundedQueue(size_t capacity, bool dropOldest)
+            : capacity_(capacity > 0 ? capacity : 1), dropOldest_(dropOldest), closed_(false), dropped_(0) {}
+
+        BoundedQueue(const BoundedQueue &) = delete;
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        // Returns false if the queue was closed
+        bool push(T item)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (dropOldest_)
+            {
+                while (!closed_ && items_.size() >= capacity_)
+                {
+                    items_.pop_front();
+                    dropped_++;
+                }
+            }
+            else
+            {
+                notFull_.wait(lock, [this]()
+                              { return closed_ || items_.size() < capacity_; });
+            }
+
+            if (closed_)
+            {
+                return false;
+            }
+
+            items_.push_back(std::move(item));
+            lock.unlock();
+            notEmpty_.notify_one();
+            return true;
+        }
+
+        // Blocks until an item is available; returns false once closed and drained
+        bool pop(T &item)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            notEmpty_.wait(lock, [this]()
+                           { return closed_ || !items_.empty(); });
+            if (items_.empty())
+            {
+                return false;
+            }
+
+            item = std::move(items_.front());
+            items_.pop_front();
+            lock.unlock();
+            notFull_.notify_one();
+            return true;
+        }
+
+        // No further pushes; with discard, pending items are dropped as well
+        void close(bool discard = false)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_ = true;
+                if (discard)
+                {
+                    items_.clear();
+                }
+            }
+            notEmpty_.notify_all();
+            notFull_.notify_all();
+        }
+
+        // Empty and open again, with the drop count reset; no thread may be blocked in push or pop
+        void reopen()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            items_.clear();
+            closed_ = false;
+            dropped_ = 0;
+        }
+
+        size_t dropped() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return dropped_;
+        }
+
+    private:
+        const size_t capacity_;
+        const bool dropOldest_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable notEmpty_;
+        std::condition_variable notFull_;
+        std::deque<T> items_;
+        bool closed_;
+        size_t dropped_;
+    };
+
+} // namespace parallel
+
+#endif // BOUNDED_QUEUE_H
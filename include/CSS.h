@@ -5,6 +5,8 @@
 #include <vector>
 #include <utility>
 #include <string>
+#include <cstdint>
+#include <memory>
 
 // =======================================================================================================
 // CSS: Curvature Scale Space for Shape Description
@@ -19,6 +21,11 @@
 //> Jue Han (jhan192@brown.edu)
 // =======================================================================================================
 
+namespace parallel
+{
+    class ThreadPool;
+}
+
 namespace css
 {
 
@@ -30,13 +37,52 @@ namespace css
         double arcLength;
     };
 
+    // Where contours come from
+    enum class ContourSource
+    {
+        Threshold, // adaptive threshold + findContours, integer pixels
+        TOED       // third-order subpixel edges linked into closed curves (SubpixelContour.h)
+    };
+
+    class SubpixelContourExtractor;
+
+    // Contour extraction settings. These are persisted in the database header so that
+    // shapes are always queried with the same preprocessing they were built with.
+    struct ContourParams
+    {
+        int blurKernelSize = 5;     // Gaussian blur before thresholding (odd)
+        int adaptiveBlockSize = 11; // adaptiveThreshold neighbourhood (odd)
+        double adaptiveC = 2.0;     // adaptiveThreshold offset
+        int morphKernelSize = 3;    // elliptical closing kernel
+        double cannyLow = 50.0;     // Canny fallback thresholds
+        double cannyHigh = 150.0;
+        int maxDimension = 800;     // larger inputs are downscaled (INTER_AREA) first; 0 disables
+        ContourSource source = ContourSource::Threshold;
+
+        bool operator==(const ContourParams &other) const;
+        bool operator!=(const ContourParams &other) const { return !(*this == other); }
+    };
+
+    // Reusable working set for extractContour. Keeping one per thread (or per video stream)
+    // avoids reallocating the intermediate images and the morphology kernel on every call.
+    struct ExtractionContext
+    {
+        cv::Mat scaled;  // downscaled input (only used above maxDimension)
+        cv::Mat gray;    // grayscale input (only used for color images)
+        cv::Mat blurred; // Gaussian-blurred input
+        cv::Mat binary;  // thresholded and closed mask
+        cv::Mat edges;   // Canny fallback
+        cv::Mat kernel;  // morphology kernel, rebuilt only when its size changes
+        int kernelSize = 0;
+        std::vector<std::vector<cv::Point>> contours;
+    };
+
     // CSS representation - zero-crossings at different scales
     struct CSSImage
     {
         std::vector<std::pair<double, double>> zeroCrossings; // (arcLength, sigma)
         int numScales;
         double maxSigma;
-        cv::Mat image; // Visual representation
     };
 
     class CSS
@@ -46,16 +92,42 @@ namespace css
         ~CSS();
 
         // Main pipeline
-        std::vector<cv::Point> extractContour(const cv::Mat &image);
+        std::vector<cv::Point> extractContour(const cv::Mat &image); // uses a thread-local context
+        std::vector<cv::Point> extractContour(const cv::Mat &image, ExtractionContext &ctx);
+
+        // All external contours whose area is at least minAreaFraction of the image, largest
+        // first. Shares one blur/threshold/morphology pass across every object in the image.
+        std::vector<std::vector<cv::Point>> extractContours(const cv::Mat &image, double minAreaFraction = 0.005);
+        std::vector<std::vector<cv::Point>> extractContours(const cv::Mat &image, double minAreaFraction,
+                                                            ExtractionContext &ctx);
+
+        // Subpixel counterparts used with ContourSource::TOED (empty if no curve is found).
+        // One detector per CSS instance is shared, so concurrent calls run one at a time.
+        std::vector<cv::Point2d> extractSubpixelContour(const cv::Mat &image);
+        std::vector<std::vector<cv::Point2d>> extractSubpixelContours(const cv::Mat &image,
+                                                                      double minAreaFraction = 0.005);
         CSSImage computeCSS(const std::vector<cv::Point> &contour,
                             double maxSigma = 4.0,
                             int numScales = 20);
+        CSSImage computeCSS(const std::vector<cv::Point2d> &contour, // e.g. from resampleContourArcLength
+                            double maxSigma = 4.0,
+                            int numScales = 20);
 
         // Core algorithms
         std::vector<ContourPoint> smoothContour(const std::vector<cv::Point> &contour, double sigma);
         std::vector<double> computeCurvature(const std::vector<ContourPoint> &smoothedContour);
         std::vector<int> findZeroCrossings(const std::vector<double> &curvature);
 
+        // Derivatives by convolving with Gaussian derivative kernels; instantiated for cv::Point
+        // and cv::Point2d contours
+        template <typename PointT>
+        void computeDerivativesWithGaussian(const std::vector<PointT> &contour,
+                                            double sigma,
+                                            std::vector<double> &dx,
+                                            std::vector<double> &dy,
+                                            std::vector<double> &d2x,
+                                            std::vector<double> &d2y);
+
         // Visualization
         cv::Mat visualizeContour(const std::vector<cv::Point> &contour,
                                  const std::vector<double> &curvature,
@@ -63,7 +135,7 @@ namespace css
         cv::Mat visualizeContour(const std::vector<ContourPoint> &smoothedContour,
                                  const std::vector<double> &curvature,
                                  cv::Size imgSize = cv::Size(512, 512));
-        cv::Mat visualizeCSSImage(const CSSImage &css);
+        cv::Mat visualizeCSSImage(const CSSImage &css); // built on demand, never stored with a descriptor
         std::vector<cv::Mat> generateProgressFrames(const std::vector<cv::Point> &contour,
                                                     double maxSigma,
                                                     int numScales);
@@ -78,8 +150,20 @@ namespace css
 
         // Utilities
         void setEdgeDetectionParams(double lowThresh, double highThresh);
+        void setContourParams(const ContourParams &params) { contourParams_ = params; }
+        const ContourParams &getContourParams() const { return contourParams_; }
+
+        // Pool the scales of computeCSS and the TOED detector run on; without one they run on the
+        // calling thread
+        void setThreadPool(std::shared_ptr<parallel::ThreadPool> pool);
 
     private:
+        // Preprocessing shared by extractContour(s): optional downscale, blur, threshold,
+        // morphology and findContours into ctx.contours. scale maps working to input pixels.
+        std::vector<std::vector<cv::Point>> &findCandidateContours(const cv::Mat &image, ExtractionContext &ctx,
+                                                                   cv::Point2d &scale);
+        static void mapToInput(std::vector<cv::Point> &contour, const cv::Point2d &scale);
+
         // Gaussian kernel for smoothing
         std::vector<double> createGaussianKernel(double sigma, int &kernelSize);
 
@@ -95,27 +179,34 @@ namespace css
                                 std::vector<double> &d2x,
                                 std::vector<double> &d2y);
 
-        // Compute derivatives by convolving with Gaussian derivative kernels
-        void computeDerivativesWithGaussian(const std::vector<cv::Point> &contour,
-                                            double sigma,
-                                            std::vector<double> &dx,
-                                            std::vector<double> &dy,
-                                            std::vector<double> &d2x,
-                                            std::vector<double> &d2y);
+        template <typename PointT>
+        CSSImage computeCSSImpl(const std::vector<PointT> &contour, double maxSigma, int numScales);
 
         // Arc length computation
         std::vector<double> computeArcLength(const std::vector<ContourPoint> &contour);
 
-        // Canny edge detection parameters
-        double cannyLow_;
-        double cannyHigh_;
-        int gaussianKernelSize_;
+        // Contour extraction parameters (blur, threshold, morphology, Canny)
+        ContourParams contourParams_;
+
+        // TOED detector and edge linker; the detector itself is allocated on first use
+        std::shared_ptr<SubpixelContourExtractor> subpixelExtractor_;
+
+        // Usually the owning recognizer's pool; null runs everything on the calling thread
+        std::shared_ptr<parallel::ThreadPool> pool_;
     };
 
     // Helper functions
     cv::Mat preprocessImage(const cv::Mat &input);
+
+    // resampleContourArcLength rounded to the pixel grid; rounded duplicates are dropped, so the
+    // result can have fewer than numPoints points
     std::vector<cv::Point> resampleContour(const std::vector<cv::Point> &contour, int numPoints);
 
+    // Resample a closed contour to exactly numPoints points spaced uniformly in arc length,
+    // interpolating linearly along the polygon (sub-pixel output)
+    std::vector<cv::Point2d> resampleContourArcLength(const std::vector<cv::Point> &contour, int numPoints);
+    std::vector<cv::Point2d> resampleContourArcLength(const std::vector<cv::Point2d> &contour, int numPoints);
+
 } // namespace css
 
 #endif // CSS_H
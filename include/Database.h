@@ -0,0 +1,140 @@
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include "CSS.h"
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// =======================================================================================================
+// Database: On-disk format of the CSS shape database
+//
+// A database file starts with a header that records the parameters the shapes were built with
+// (CSS scales and contour extraction settings) together with a 64-bit fingerprint of them.
+// Loading a database adopts these parameters, and comparing fingerprints is enough to tell
+// whether a recognizer is configured compatibly with the shapes it holds.
+//
+// A sharded database is a text manifest listing N ordinary database files (shards) that share
+// one parameter fingerprint. Every shard can be loaded and searched on its own.
+//
+// Files written before the header existed (a bare shape count followed by the shapes) are
+// still readable; they are reported as legacy and carry no parameters.
+//
+// ChangeLogs
+//    Oct 18, 2026    Moved ShapeEntry here, added parameter header and fingerprint
+//    Oct 18, 2026    Added shard manifests
+//    Oct 18, 2026    Added DatabaseReader for chunked streaming reads
+//    Oct 18, 2026    Version 3: input downscaling limit (maxDimension) in the header
+//    Oct 18, 2026    Version 4: arc-length resampling budget (resamplePoints) in the header
+//    Oct 18, 2026    Version 5: contour source (threshold or TOED) in the header
+//    Oct 18, 2026    Version 6: subpixel curves of TOED shapes, so they can be reindexed
+//    Oct 18, 2026    Counts and sizes checked against the file length before allocating
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace recognition
+{
+
+    // Database entry for a shape
+    struct ShapeEntry
+    {
+        std::string name;
+        std::string imagePath;
+        std::vector<cv::Point> contour;
+        std::vector<cv::Point2d> curve; // subpixel source of a ContourSource::TOED descriptor, else empty
+        css::CSSImage cssImage;
+        double matchScore; // For query results
+    };
+
+    // Everything that influences the CSS descriptor of a shape
+    struct DatabaseParams
+    {
+        double maxSigma = 4.0;
+        int numScales = 20;
+        int resamplePoints = 256; // contours are resampled to this many points by arc length; 0 disables
+        css::ContourParams contour;
+
+        // FNV-1a hash over all fields; equal fingerprints mean comparable descriptors.
+        // Zero resamplePoints / maxDimension and the threshold contour source hash like the older
+        // headers that lacked them, so existing fingerprints stay valid.
+        uint64_t fingerprint() const;
+    };
+
+    struct DatabaseHeader
+    {
+        uint32_t version = 0;
+        bool legacy = false; // true for files without a parameter header
+        DatabaseParams params;
+        uint64_t fingerprint = 0;
+        size_t numShapes = 0;
+        std::streamoff streamEnd = -1; // end offset of the stream read from; -1 when unknown
+    };
+
+    // Current on-disk format version. Older files are read with the settings they predate
+    // disabled (0), which is what they were built with: version 2 lacks
+    // ContourParams::maxDimension, versions 2-3 lack resamplePoints, versions 2-4 predate
+    // ContourParams::source and always used threshold contours. Versions 2-5 store no subpixel
+    // curves, so their TOED shapes cannot be reindexed.
+    constexpr uint32_t kDatabaseVersion = 6;
+    constexpr uint32_t kOldestDatabaseVersion = 2;
+
+    // Header I/O. readDatabaseHeader returns false on I/O errors or a corrupt header, including a
+    // shape count the rest of a seekable stream cannot hold (e.g. a file that is no database).
+    void writeDatabaseHeader(std::ostream &os, const DatabaseParams &params, size_t numShapes);
+    bool readDatabaseHeader(std::istream &is, DatabaseHeader &header);
+
+    // Shape entry I/O (name, contour, CSS zero crossings, subpixel curve from version 6 on).
+    // readShapeEntry returns false, without allocating, on a size that overruns header.streamEnd.
+    void writeShapeEntry(std::ostream &os, const ShapeEntry &shape);
+    bool readShapeEntry(std::istream &is, ShapeEntry &shape, const DatabaseHeader &header);
+
+    // Whole-file I/O. Legacy files get defaultParams with resampling and downscaling disabled;
+    // shapes may be a subset of a larger database.
+    bool writeDatabaseFile(const std::string &filepath, const DatabaseParams &params,
+                           const ShapeEntry *shapes, size_t numShapes);
+    bool readDatabaseFile(const std::string &filepath, const DatabaseParams &defaultParams,
+                          DatabaseHeader &header, std::vector<ShapeEntry> &shapes);
+
+    // Sequential reader that hands out a database file in fixed-size chunks of shapes.
+    // Chunk vectors are reused across calls so their string/contour storage is recycled.
+    class DatabaseReader
+    {
+    public:
+        DatabaseReader() = default;
+        DatabaseReader(const DatabaseReader &) = delete;
+        DatabaseReader &operator=(const DatabaseReader &) = delete;
+
+        bool open(const std::string &filepath, const DatabaseParams &defaultParams);
+        const DatabaseHeader &header() const { return header_; }
+        size_t remaining() const { return header_.numShapes - numRead_; }
+
+        // Fills chunk with up to maxShapes entries; returns the number read (0 at end or on error)
+        size_t readChunk(std::vector<ShapeEntry> &chunk, size_t maxShapes);
+        bool failed() const { return failed_; }
+
+    private:
+        std::ifstream ifs_;
+        std::vector<char> buffer_;
+        DatabaseHeader header_;
+        size_t numRead_ = 0;
+        bool failed_ = false;
+    };
+
+    // Shard manifest: fingerprint shared by all shards and their file paths
+    struct ShardManifest
+    {
+        uint64_t fingerprint = 0;
+        std::vector<std::string> shardPaths; // absolute or relative to the manifest directory
+    };
+
+    bool writeShardManifest(const std::string &manifestPath, const ShardManifest &manifest);
+    bool readShardManifest(const std::string &manifestPath, ShardManifest &manifest); // resolves paths
+
+} // namespace recognition
+
+#endif // DATABASE_H
@@ -0,0 +1,65 @@
+#ifndef EXECUTION_CONTEXT_H
+#define EXECUTION_CONTEXT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// =======================================================================================================
+// ExecutionContext: Thread count, CPU pinning and nested-parallel policy of one recognizer
+//
+// A Recognition builds its ThreadPool from it, and CSS and the TOED detector run their loops on that
+// pool, so every subsystem uses the same threads instead of sizing its own from the machine or the
+// global OpenMP state. Recognizers co-located on one machine each take a disjoint slice of
+// the CPUs with partition(), so together they never run more threads than there are cores:
+//
+//    recognition::Recognition a(parallel::ExecutionContext::partition(0, 2));
+//    recognition::Recognition b(parallel::ExecutionContext::partition(1, 2));
+//
+// ChangeLogs
+//    Oct 18, 2026    Created to stop co-located recognizers from oversubscribing cores
+//    Oct 18, 2026    Nested loops share the work-stealing pool; spread by default
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace parallel
+{
+
+    // What a ThreadPool::parallelFor started on one of the pool's own workers does, e.g. the scales
+    // of a descriptor built inside a per-image task. Either way no threads are added.
+    enum class NestedPolicy
+    {
+        Serial, // the calling worker runs the whole loop
+        Spread  // the loop is split into chunks that idle workers of the same pool steal
+    };
+
+    struct ExecutionContext
+    {
+        size_t numThreads = 0; // 0: one per CPU in cpus, or per CPU the process may use
+        std::vector<int> cpus; // threads are pinned round-robin; empty leaves placement to the OS
+        NestedPolicy nested = NestedPolicy::Spread;
+
+        size_t resolvedThreads() const;
+
+        // Pin the calling thread to cpus[index % cpus.size()]; true if cpus is empty
+        bool pin(size_t index) const;
+
+        // Slice index of count contiguous, disjoint slices of availableCpus(), pinned with one
+        // thread per CPU. Every slice gets at least one CPU; slices share CPUs only when count
+        // exceeds the number of CPUs.
+        static ExecutionContext partition(size_t index, size_t count);
+    };
+
+    // CPUs in the affinity mask of the process, ascending (0..n-1 where it cannot be queried)
+    std::vector<int> availableCpus();
+
+    // Parses a CPU list such as "0-3,8,10-11"
+    bool parseCpuList(const std::string &list, std::vector<int> &cpus);
+
+    bool pinCurrentThread(const std::vector<int> &cpus, size_t index);
+
+} // namespace parallel
+
+#endif // EXECUTION_CONTEXT_H
@@ -0,0 +1,97 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <string>
+
+// =======================================================================================================
+// Logging: Leveled, thread-safe logging and event counters for the CSS, Recognition and TOED code
+//
+// Messages below CSS_LOG_LEVEL are removed at compile time; the remaining ones are filtered by a
+// runtime level. Each message is formatted off-lock and emitted as one write, so lines from
+// different threads never interleave. Only warnings and errors are flushed.
+//
+// Hot paths count events (CSS_LOG_COUNT) instead of printing per item; counters are lock-free
+// after first use and can be dumped with logging::counters().
+//
+// ChangeLogs
+//    Oct 18, 2026    Created to take console I/O off the recognition hot path
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+// 0 = debug, 1 = info, 2 = warning, 3 = error, 4 = off
+#ifndef CSS_LOG_LEVEL
+#define CSS_LOG_LEVEL 1
+#endif
+
+namespace logging
+{
+
+    enum class Level
+    {
+        Debug = 0,
+        Info = 1,
+        Warning = 2,
+        Error = 3,
+        Off = 4
+    };
+
+    // Runtime threshold (default Info)
+    void setLevel(Level level);
+    Level getLevel();
+    inline bool enabled(Level level) { return static_cast<int>(level) >= static_cast<int>(getLevel()); }
+
+    // Emits one complete line; info/debug go to stdout, warnings/errors to stderr
+    void write(Level level, const std::string &message);
+
+    // Named monotonically increasing counter
+    class Counter
+    {
+    public:
+        void add(uint64_t delta = 1) { value_.fetch_add(delta, std::memory_order_relaxed); }
+        uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+        void reset() { value_.store(0, std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint64_t> value_{0};
+    };
+
+    // Returns the counter registered under name, creating it on first use
+    Counter &counter(const std::string &name);
+    std::map<std::string, uint64_t> counters();
+    void resetCounters();
+    std::string formatCounters(); // "name: value" lines
+
+} // namespace logging
+
+#define CSS_LOG_AT(level, expr)                       \
+    do                                                \
+    {                                                 \
+        if (static_cast<int>(level) >= CSS_LOG_LEVEL && \
+            logging::enabled(level))                  \
+        {                                             \
+            std::ostringstream css_log_stream_;       \
+            css_log_stream_ << expr;                  \
+            logging::write(level, css_log_stream_.str()); \
+        }                                             \
+    } while (0)
+
+#define CSS_LOG_DEBUG(expr) CSS_LOG_AT(logging::Level::Debug, expr)
+#define CSS_LOG_INFO(expr) CSS_LOG_AT(logging::Level::Info, expr)
+#define CSS_LOG_WARNING(expr) CSS_LOG_AT(logging::Level::Warning, expr)
+#define CSS_LOG_ERROR(expr) CSS_LOG_AT(logging::Level::Error, expr)
+
+// Counter handle is looked up once per call site
+#define CSS_LOG_COUNT(name, delta)                                          \
+    do                                                                      \
+    {                                                                       \
+        static logging::Counter &css_log_counter_ = logging::counter(name); \
+        css_log_counter_.add(delta);                                        \
+    } while (0)
+
+#endif // LOGGING_H
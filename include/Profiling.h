@@ -0,0 +1,123 @@
+#ifndef PROFILING_H
+#define PROFILING_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+// =======================================================================================================
+// Profiling: Scoped timers and counters for the CSS, Recognition and TOED stages
+//
+// Timings and counts accumulate in per-thread tables, so recording never contends with other
+// threads; the tables are merged when a snapshot is read. Each call site resolves its name once.
+// Build with -DCSS_PROFILING=1 (CMake option CSS_PROFILING) to enable; otherwise the macros
+// compile to nothing and snapshots are empty.
+//
+//    CSS_PROFILE_SCOPE("css.smooth");              // times the rest of the enclosing block
+//    CSS_PROFILE_RECORD("toed.nms", ms);           // adds a duration measured elsewhere
+//    CSS_PROFILE_COUNT("recognition.distances", n); // adds to a counter
+//
+// A scope costs two clock reads and a table update, so time whole stages rather than inner-loop
+// calls, and count per batch of work rather than per item.
+//
+// ChangeLogs
+//    Oct 18, 2026    Created for per-stage timing reports
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+#ifndef CSS_PROFILING
+#define CSS_PROFILING 0
+#endif
+
+namespace profiling
+{
+
+    enum class Kind
+    {
+        Timer,
+        Counter
+    };
+
+    struct Stat
+    {
+        Kind kind = Kind::Timer;
+        uint64_t calls = 0;    // timers: samples, counters: sum of deltas
+        double totalMs = 0.0;  // timers only
+        double minMs = 0.0;
+        double maxMs = 0.0;
+
+        double meanMs() const { return calls ? totalMs / calls : 0.0; }
+        void merge(const Stat &other);
+    };
+
+    // True when the instrumentation macros are compiled in
+    constexpr bool compiledIn() { return CSS_PROFILING != 0; }
+
+    // Id of the named site, registering it on first use
+    int site(const std::string &name, Kind kind = Kind::Timer);
+
+    void record(int site, double ms);
+    void count(int site, uint64_t delta);
+
+    // All threads merged, including threads that have exited
+    std::map<std::string, Stat> snapshot();
+    void reset();
+
+    std::string formatReport(); // one aligned line per site, in name order
+    std::string formatJson();   // {"timers": {...}, "counters": {...}}
+
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(int site) : site_(site), start_(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer()
+        {
+            record(site_, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count());
+        }
+
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    private:
+        int site_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+} // namespace profiling
+
+#define CSS_PROFILE_CONCAT_(a, b) a##b
+#define CSS_PROFILE_CONCAT(a, b) CSS_PROFILE_CONCAT_(a, b)
+
+#if CSS_PROFILING
+
+#define CSS_PROFILE_SCOPE(name)                                                                        \
+    static const int CSS_PROFILE_CONCAT(css_profile_site_, __LINE__) = profiling::site(name);          \
+    profiling::ScopedTimer CSS_PROFILE_CONCAT(css_profile_timer_, __LINE__)(                            \
+        CSS_PROFILE_CONCAT(css_profile_site_, __LINE__))
+
+#define CSS_PROFILE_RECORD(name, ms)                                           \
+    do                                                                         \
+    {                                                                          \
+        static const int css_profile_site_ = profiling::site(name);            \
+        profiling::record(css_profile_site_, ms);                              \
+    } while (0)
+
+#define CSS_PROFILE_COUNT(name, delta)                                                        \
+    do                                                                                        \
+    {                                                                                         \
+        static const int css_profile_site_ = profiling::site(name, profiling::Kind::Counter); \
+        profiling::count(css_profile_site_, delta);                                           \
+    } while (0)
+
+#else
+
+#define CSS_PROFILE_SCOPE(name) ((void)0)
+#define CSS_PROFILE_RECORD(name, ms) ((void)0)
+#define CSS_PROFILE_COUNT(name, delta) ((void)0)
+
+#endif
+
+#endif // PROFILING_H
@@ -2,16 +2,18 @@
 #define RECOGNITION_H
 
 #include "CSS.h"
+#include "Database.h"
+#include "ResultCache.h"
+#include "ThreadPool.h"
+#include "TopK.h"
 #include "toed/cpu_toed.hpp"
 #include <opencv2/opencv.hpp>
+#include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
-
 // =======================================================================================================
 // Recognition: Object Recognition based on CSS and TOED
 //
@@ -28,44 +30,137 @@
 namespace recognition
 {
 
-    // Database entry for a shape
-    struct ShapeEntry
+    // What to do when the recognizer parameters no longer match the loaded database
+    enum class MismatchPolicy
     {
-        std::string name;
-        std::string imagePath;
-        std::vector<cv::Point> contour;
-        css::CSSImage cssImage;
-        double matchScore; // For query results
+        Reject, // refuse queries and additions until parameters match again
+        Reindex // recompute CSS descriptors from the stored contours
+    };
+
+    // One object found in a multi-object image and its best database matches
+    struct ObjectMatch
+    {
+        std::vector<cv::Point> contour; // in input image coordinates
+        std::vector<ShapeEntry> matches;
+    };
+
+    // Query shape handed between recognition stages; curve is only set for ContourSource::TOED
+    struct QueryShape
+    {
+        std::vector<cv::Point> contour; // in input image coordinates
+        std::vector<cv::Point2d> curve;
     };
 
     class Recognition
     {
     public:
-        Recognition();
+        explicit Recognition(const parallel::ExecutionContext &context = parallel::ExecutionContext());
         ~Recognition();
 
-        // Database management
+        // Database management. Loading replaces the database in place and must not run
+        // concurrently with queries; long-running services swap recognizers (RecognizerHandle).
         bool loadShapeDatabase(const std::string &databaseDir);
         void addShape(const std::string &name, const cv::Mat &image);
         void addShape(const std::string &name, const std::vector<cv::Point> &contour);
+        void addShapes(const std::vector<std::string> &names,
+                       const std::vector<std::vector<cv::Point>> &contours); // descriptors in parallel
         void saveDatabase(const std::string &filepath);
-        void loadDatabase(const std::string &filepath);
+        bool loadDatabase(const std::string &filepath);
         void clearDatabase();
+        bool reindexDatabase();
+
+        // Sharded databases: a manifest listing independently loadable shard files
+        bool saveShardedDatabase(const std::string &manifestPath, int numShards);
+        bool loadShardedDatabase(const std::string &manifestPath);
 
         // Recognition
         std::vector<ShapeEntry> recognizeShape(const cv::Mat &queryImage, int topK = 5);
         std::vector<ShapeEntry> recognizeShape(const std::vector<cv::Point> &queryContour, int topK = 5);
 
+        // Batch recognition: query descriptors are computed in parallel, then database blocks are
+        // scored against blocks of queries so each database block is reused while it is in cache
+        std::vector<std::vector<ShapeEntry>> recognizeBatch(const std::vector<cv::Mat> &queryImages, int topK = 5);
+        std::vector<std::vector<ShapeEntry>> recognizeBatch(const std::vector<std::vector<cv::Point>> &queryContours,
+                                                            int topK = 5);
+
+        // Recognize every object in an image: all contours covering at least minAreaFraction of
+        // the image come from one preprocessing pass and are scored together via recognizeBatch
+        std::vector<ObjectMatch> recognizeObjects(const cv::Mat &image, int topK = 5,
+                                                  double minAreaFraction = 0.005);
+
+        // The stages of recognizeShape(image) for callers that run them concurrently (VideoPipeline):
+        // extraction, descriptor and matching touch disjoint state. No result caching is applied.
+        bool extractQuery(const cv::Mat &image, QueryShape &query);
+        css::CSSImage describeQuery(const QueryShape &query);
+        std::vector<ShapeEntry> matchQuery(const css::CSSImage &queryCSS, int topK = 5);
+
+        // Same result, with the scan bounded by the distances to earlier matches (e.g. the
+        // previous video frame's top-K, which must still be in the database)
+        std::vector<ShapeEntry> matchQuery(const css::CSSImage &queryCSS, int topK,
+                                           const std::vector<ShapeEntry> &warmStart);
+
+        // Switch to the parameters a database file or .shards manifest was built with, so it can be
+        // searched with the streaming queries below. Fails if they conflict with a loaded database.
+        bool useDatabaseParameters(const std::string &path);
+
+        // Search a sharded database without loading it: shards are read, scored and released
+        // one per worker, so memory is bounded by the shard size times the number of workers
+        std::vector<ShapeEntry> recognizeShapeStreamingShards(const std::string &manifestPath,
+                                                              const std::vector<cv::Point> &queryContour,
+                                                              int topK = 5);
+
+        // Search a single database file without loading it: shapes are read in chunks of
+        // chunkSize with the next chunk loading in the background while the current one is scored
+        std::vector<ShapeEntry> recognizeShapeStreaming(const std::string &filepath,
+                                                        const cv::Mat &queryImage,
+                                                        int topK = 5,
+                                                        size_t chunkSize = 4096);
+        std::vector<ShapeEntry> recognizeShapeStreaming(const std::string &filepath,
+                                                        const std::vector<cv::Point> &queryContour,
+                                                        int topK = 5,
+                                                        size_t chunkSize = 4096);
+
         // Distance computation
         double computeShapeDistance(const css::CSSImage &css1, const css::CSSImage &css2);
 
+        // Convert CSS zero-crossings to sequences for TOED
+        std::vector<std::vector<double>> cssToSequences(const css::CSSImage &css);
+
+        // TOED distance computation. The sequence form is the reference implementation; the
+        // zero-crossing form computes the same distance directly on the contiguous CSS data and
+        // stops early, returning the maximum double, once the distance must exceed bound.
+        double toedDistance(const std::vector<std::vector<double>> &seq1,
+                            const std::vector<std::vector<double>> &seq2);
+        static double toedDistance(const std::vector<std::pair<double, double>> &zc1,
+                                   const std::vector<std::pair<double, double>> &zc2,
+                                   double bound = std::numeric_limits<double>::max());
+
         // Configuration
         void setCSSParameters(double maxSigma, int numScales);
+        void setResamplePoints(int numPoints); // arc-length resampling budget, 0 uses raw contours
         void setEdgeDetectionParams(double lowThresh, double highThresh);
+        void setContourParams(const css::ContourParams &params);
+        void setContourSource(css::ContourSource source); // threshold (default) or TOED subpixel curves
+        void setMismatchPolicy(MismatchPolicy policy) { mismatchPolicy_ = policy; }
+        void setNumThreads(size_t numThreads); // search and batch workers, 0 = one per core
+        size_t getNumThreads() const { return pool_->size(); }
+
+        // Workers, their CPUs and the TOED threads they may start; recreates the worker pool
+        void setExecutionContext(const parallel::ExecutionContext &context);
+        const parallel::ExecutionContext &getExecutionContext() const { return context_; }
+        DatabaseParams getParameters() const;
+
+        // Result cache for repeated queries (capacity 0 disables it)
+        void setResultCacheCapacity(size_t capacity) { resultCache_.setCapacity(capacity); }
+        CacheStats getCacheStats() const { return resultCache_.stats(); }
+        void resetCacheStats() { resultCache_.resetStats(); }
 
         // Database info
         int getDatabaseSize() const { return database_.size(); }
         const std::vector<ShapeEntry> &getDatabase() const { return database_; }
+        const DatabaseParams &getDatabaseParameters() const { return databaseParams_; }
+        size_t getNumShards() const { return shardOffsets_.size(); }
+        bool isDatabaseCompatible() const;
 
         // Visualization
         cv::Mat visualizeMatches(const cv::Mat &queryImage,
@@ -76,16 +171,77 @@ namespace recognition
         css::CSS cssComputer_;
         std::vector<ShapeEntry> database_;
 
+        // Start index of each loaded shard within database_ (empty when not sharded)
+        std::vector<size_t> shardOffsets_;
+
+        // Work-stealing workers built from context_, shared with cssComputer_ so descriptor
+        // scales and TOED rows run on the same threads as searches, batches and database builds
+        parallel::ExecutionContext context_;
+        std::shared_ptr<parallel::ThreadPool> pool_;
+
+        // Cached results, invalidated whenever databaseGeneration_ changes
+        ResultCache resultCache_;
+        uint64_t databaseGeneration_;
+        void markDatabaseChanged() { databaseGeneration_++; }
+
         // CSS parameters
         double maxSigma_;
         int numScales_;
+        int resamplePoints_;
 
-        // Convert CSS zero-crossings to sequences for TOED
-        std::vector<std::vector<double>> cssToSequences(const css::CSSImage &css);
+        // CSS descriptor of a contour under the current parameters (resampled if enabled)
+        css::CSSImage computeDescriptor(const std::vector<cv::Point> &contour);
+        css::CSSImage computeDescriptor(const std::vector<cv::Point2d> &curve);
 
-        // TOED distance computation
-        double toedDistance(const std::vector<std::vector<double>> &seq1,
-                            const std::vector<std::vector<double>> &seq2);
+        // Main object of an image under the configured contour source, with its descriptor.
+        // With ContourSource::TOED the descriptor comes from the subpixel curve, which the
+        // database stores next to the curve on the pixel grid so reindexing can start from it.
+        bool usesSubpixelContours() const;
+        bool describeImage(const cv::Mat &image, QueryShape &shape, css::CSSImage &descriptor);
+        static std::vector<cv::Point> roundCurve(const std::vector<cv::Point2d> &curve);
+
+        // Fingerprint of the current parameters, refreshed whenever they change
+        uint64_t paramsFingerprint_;
+
+        // Parameters the shapes in database_ were built with, and their fingerprint
+        DatabaseParams databaseParams_;
+        uint64_t databaseFingerprint_;
+        MismatchPolicy mismatchPolicy_;
+
+        void updateParamsFingerprint();
+
+        // Switch to the parameters a database was built with
+        void adoptParameters(const DatabaseParams &params);
+
+        // Streaming queries never change the configuration; they fail if params differ from it
+        bool checkStreamingParameters(const DatabaseParams &params) const;
+
+        // [begin, end) ranges of database_ searched as independent tasks
+        std::vector<std::pair<size_t, size_t>> searchPartitions() const;
+
+        // Check the parameter fingerprint before touching the database; applies mismatchPolicy_
+        bool ensureCompatibleDatabase();
+
+        // Uncached single-query search
+        std::vector<ShapeEntry> matchContour(const std::vector<cv::Point> &queryContour, int topK);
+        std::vector<ShapeEntry> matchDescriptor(const css::CSSImage &queryCSS, int topK,
+                                                double bound = std::numeric_limits<double>::max());
+
+        // Score query descriptors against the whole database, a query tile against a database tile at a
+        // time, with early-abandoned distances as in matchDescriptor
+        std::vector<std::vector<ShapeEntry>> matchBatch(const std::vector<css::CSSImage> &queryCSS, int topK);
+
+        // ContourSource::TOED variants of the image entry points
+        std::vector<std::vector<ShapeEntry>> recognizeBatchSubpixel(const std::vector<cv::Mat> &queryImages, int topK);
+        std::vector<ObjectMatch> recognizeObjectsSubpixel(const cv::Mat &image, int topK, double minAreaFraction);
+
+        // Chunked scan of an opened database file with double-buffered reads
+        std::vector<ShapeEntry> streamDescriptor(DatabaseReader &reader, const css::CSSImage &queryCSS,
+                                                 int topK, size_t chunkSize);
+
+        // Append a shape whose descriptor is already computed (from curve unless it is empty)
+        void addEntry(const std::string &name, const std::vector<cv::Point> &contour, css::CSSImage descriptor,
+                      const std::vector<cv::Point2d> &curve = std::vector<cv::Point2d>());
     };
 
 } // namespace recognition
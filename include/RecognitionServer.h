@@ -0,0 +1,147 @@
+#ifndef RECOGNITION_SERVER_H
+#define RECOGNITION_SERVER_H
+
+#include "Recognition.h"
+#include "RecognizerHandle.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// =======================================================================================================
+// RecognitionServer: Long-running recognition service on a local socket
+//
+// The database is loaded once and queries arrive over a Unix domain socket (or localhost TCP), so
+// a request costs contour extraction plus matching instead of process startup and a database load.
+// One event thread polls all idle connections; each request that arrives becomes a task of a fixed
+// worker pool, so idle clients hold no worker. A connection may carry any number of requests, and
+// one that stalls in the middle of a request for longer than requestTimeoutMs is closed. A request
+// that throws is answered with an error and its connection closed.
+//
+// Concurrency comes from requests, not from inside them: a worker runs its whole request,
+// extraction and matching, under a parallel::SerialScope, so the loops of the recognizer do not
+// add its own threads on top of the workers. The workers take the recognizer's ExecutionContext,
+// so by default they are as many as its threads and pinned to the same CPUs; numWorkers only
+// changes their count.
+//
+// Protocol, integers big-endian:
+//    request   uint32 length | uint8 kind | uint8 topK | payload      (length covers the rest)
+//                kind 1: payload is an encoded image (PNG, JPEG, ... anything cv::imdecode reads)
+//                kind 2: payload is a contour, int32 x and int32 y per point
+//                kind 3: payload is a database path (.dat or .shards) to reload in the background
+//                topK 0 asks for the default of 5 matches
+//    response  uint32 length | JSON text
+//                {"status": "ok", "database_version": 0, "latency_ms": 1.2,
+//                 "matches": [{"name": "apple", "distance": 0.1}, ...]}
+//                {"status": "error", "message": "..."}
+//
+// Reloads never block queries: the new database is loaded into a separate recognizer and swapped
+// in through a RecognizerHandle, while requests already running finish on the old one. Reloads run
+// one at a time on a dedicated thread.
+//
+// ChangeLogs
+//    Oct 18, 2026    Created for the serve mode
+//    Oct 18, 2026    Hot database reload through a RecognizerHandle
+//    Oct 18, 2026    Per-request dispatch from a poll loop; workers follow the ExecutionContext
+//    Oct 18, 2026    A reload that throws is logged and keeps the current database
+//    Oct 18, 2026    Requests run serially on their worker; failed requests and accepts handled
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace recognition
+{
+
+    enum RequestKind : uint8_t
+    {
+        RequestImage = 1,
+        RequestContour = 2,
+        RequestReload = 3
+    };
+
+    struct ServerOptions
+    {
+        std::string socketPath = "/tmp/css_recognition.sock"; // Unix domain socket; never replaces a non-socket
+        int tcpPort = 0;                                      // > 0: listen on 127.0.0.1:tcpPort instead
+        size_t numWorkers = 0;                                // concurrent requests, 0 = the recognizer's threads
+        uint32_t maxRequestBytes = 64u << 20;                 // larger requests close the connection
+        int requestTimeoutMs = 5000;                          // longest stall within a request or response;
+                                                              // the client also waits this long for an answer
+    };
+
+    class RecognitionServer
+    {
+    public:
+        // The recognizer is shared with in-flight requests; replace it with requestReload, not in place
+        explicit RecognitionServer(std::shared_ptr<Recognition> recognizer,
+                                   const ServerOptions &options = ServerOptions());
+        ~RecognitionServer();
+
+        RecognitionServer(const RecognitionServer &) = delete;
+        RecognitionServer &operator=(const RecognitionServer &) = delete;
+
+        // Bind, listen and start accepting in the background. Workers are placed like the
+        // recognizer's ExecutionContext. Fails if the socket path exists and is not a socket.
+        bool start();
+
+        // Stop accepting, close open connections and wait for the workers
+        void stop();
+
+        // Load a database into a new recognizer on the reload thread and swap it in when complete.
+        // Returns false if a reload is already pending or running. A database that fails to load,
+        // or throws while loading, is logged and leaves the current one in place.
+        bool requestReload(const std::string &databasePath);
+        bool reloadInProgress() const;
+
+        uint64_t requestsServed() const { return requestsServed_; }
+        uint64_t databaseVersion() const { return handle_.version(); }
+
+    private:
+        void eventLoop();
+        void reloadLoop();
+        void serveRequest(int fd);
+        void closeConnection(int fd);
+        std::string handleRequest(const std::vector<uint8_t> &request);
+
+        RecognizerHandle handle_;
+        ServerOptions options_;
+
+        // Reloads are handed to reloadThread_, which alone loads and publishes recognizers
+        std::thread reloadThread_;
+        mutable std::mutex reloadMutex_;
+        std::condition_variable reloadCv_;
+        std::string pendingReload_;
+        bool reloadPending_;
+        bool reloading_; // pending or running
+        bool reloadShutdown_;
+
+        int listenFd_;
+        int wakeFds_[2]; // pipe that wakes the event loop when a connection is returned
+        std::atomic<bool> stopping_;
+        std::thread eventThread_;
+        std::unique_ptr<parallel::ThreadPool> workers_;
+
+        // Open connections, shut down by stop() to unblock their tasks. A connection is either
+        // polled by the event loop or owned by the one task handling its current request; tasks
+        // hand it back through returned_.
+        std::mutex connectionsMutex_;
+        std::set<int> connections_;
+        std::vector<int> returned_;
+
+        std::atomic<uint64_t> requestsServed_;
+    };
+
+    // Client side of the protocol: send one request and wait for the JSON response
+    bool sendRecognitionRequest(const ServerOptions &endpoint, RequestKind kind, int topK,
+                                const std::vector<uint8_t> &payload, std::string &response);
+
+} // namespace recognition
+
+#endif // RECOGNITION_SERVER_H
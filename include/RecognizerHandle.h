@@ -0,0 +1,65 @@
+#ifndef RECOGNIZER_HANDLE_H
+#define RECOGNIZER_HANDLE_H
+
+#include "Recognition.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// =======================================================================================================
+// RecognizerHandle: Read-copy-update handle to the recognizer of a long-running process
+//
+// Loading into a live Recognition clears its database first, which races with queries and leaves an
+// empty window. Instead, a replacement recognizer is loaded on the side and published with an atomic
+// pointer swap. Queries acquire a shared_ptr snapshot and finish on it, so they never wait for a
+// reload and never see a partial database. Each snapshot carries the version it was published as.
+// Publishing does not wait: whoever drops the last reference frees the previous recognizer, which
+// joins its pool, so that reference must not be held by one of that recognizer's own workers.
+//
+// ChangeLogs
+//    Oct 18, 2026    Created for hot database reloads
+//    Oct 18, 2026    Version stored with the snapshot; publish no longer waits for old readers
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace recognition
+{
+
+    // A published recognizer and its version (0 for the initial one)
+    struct RecognizerSnapshot
+    {
+        std::shared_ptr<Recognition> recognizer;
+        uint64_t version = 0;
+    };
+
+    class RecognizerHandle
+    {
+    public:
+        explicit RecognizerHandle(std::shared_ptr<Recognition> recognizer);
+
+        RecognizerHandle(const RecognizerHandle &) = delete;
+        RecognizerHandle &operator=(const RecognizerHandle &) = delete;
+
+        // The current recognizer; it stays valid across later swaps
+        std::shared_ptr<Recognition> acquire() const { return snapshot().recognizer; }
+
+        // The current recognizer together with its version, read in one atomic load
+        RecognizerSnapshot snapshot() const;
+
+        // Swap in a fully loaded recognizer and return at once; the previous one lives on until its
+        // last query drops it
+        void publish(std::shared_ptr<Recognition> recognizer);
+
+        // Number of recognizers published after the initial one
+        uint64_t version() const { return snapshot().version; }
+
+    private:
+        std::shared_ptr<const RecognizerSnapshot> current_; // accessed only through std::atomic_load/atomic_store
+        std::mutex publishMutex_;                           // serializes publishers only
+    };
+
+} // namespace recognition
+
+#endif // RECOGNIZER_HANDLE_H
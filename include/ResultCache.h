@@ -0,0 +1,87 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "Database.h"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// =======================================================================================================
+// ResultCache: LRU cache of recognition results for repeated queries
+//
+// Results are keyed by a 64-bit hash of the query (image bytes or extracted contour) combined
+// with topK and the parameter fingerprint. The cache is tied to a database generation and
+// empties itself when the database changes.
+//
+// ChangeLogs
+//    Oct 18, 2026    Created for repeated-query caching
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace recognition
+{
+
+    struct CacheStats
+    {
+        uint64_t imageHits = 0;     // served before contour extraction
+        uint64_t contourHits = 0;   // served after extraction, before CSS and matching
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t invalidations = 0; // clears caused by database changes
+
+        uint64_t hits() const { return imageHits + contourHits; }
+        double hitRate() const
+        {
+            uint64_t lookups = hits() + misses;
+            return lookups > 0 ? static_cast<double>(hits()) / lookups : 0.0;
+        }
+    };
+
+    class ResultCache
+    {
+    public:
+        explicit ResultCache(size_t capacity = 256);
+
+        // capacity 0 disables caching
+        void setCapacity(size_t capacity);
+        size_t capacity() const;
+
+        // Drops all entries if the database generation differs from the cached one
+        void sync(uint64_t databaseGeneration);
+
+        bool lookup(uint64_t key, std::vector<ShapeEntry> &results);
+        void insert(uint64_t key, const std::vector<ShapeEntry> &results);
+        void clear();
+
+        // Hit accounting is done by the caller, which knows which kind of key matched
+        void recordImageHit();
+        void recordContourHit();
+        void recordMiss();
+        CacheStats stats() const;
+        void resetStats();
+
+        // Query hashes
+        static uint64_t hashImage(const cv::Mat &image);
+        static uint64_t hashContour(const std::vector<cv::Point> &contour);
+        static uint64_t combine(uint64_t hash, uint64_t value);
+
+    private:
+        void evictToCapacity();
+
+        using Entry = std::pair<uint64_t, std::vector<ShapeEntry>>;
+
+        mutable std::mutex mutex_;
+        size_t capacity_;
+        uint64_t generation_;
+        std::list<Entry> lru_; // most recently used at the front
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+        CacheStats stats_;
+    };
+
+} // namespace recognition
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,83 @@
+#ifndef SUBPIXEL_CONTOUR_H
+#define SUBPIXEL_CONTOUR_H
+
+#include "CSS.h"
+#include <memory>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// =======================================================================================================
+// SubpixelContour: Closed contours from third-order (TOED) subpixel edges
+//
+// The detector returns unordered edge points with a tangent orientation. Near-duplicate edges are
+// clustered, then chains are grown from a seed edge by repeatedly stepping to the closest unvisited
+// edge ahead along the tangent whose own tangent turns by less than a fixed angle; a chain whose
+// ends meet is closed. Both steps query an EdgeGrid, so extraction is linear in the edge count. Closed chains are
+// the subpixel counterpart of the external contours found by CSS::extractContour.
+//
+// ChangeLogs
+//    Oct 18, 2026    Created as the ContourSource::TOED contour extraction path
+//    Oct 18, 2026    Clustering and linking use the EdgeGrid spatial index
+//    Oct 18, 2026    Detector threads and pinning follow an ExecutionContext
+//    Oct 18, 2026    The detector runs on the owner's thread pool
+//    Oct 18, 2026    Concurrent calls check out their own detector instead of sharing one
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+// TOED types (toed/cpu_toed.hpp); kept out of this header because of the TOED index macros
+struct Edge;
+class ThirdOrderEdgeDetectionCPU;
+
+namespace css
+{
+
+    // Ordered edge indices of one linked chain
+    struct EdgeChain
+    {
+        std::vector<int> edges;
+        bool closed = false;
+    };
+
+    // Link edges (location + tangent orientation) of an imageSize image into chains, longest first
+    std::vector<EdgeChain> linkEdges(const std::vector<Edge> &edges, cv::Size imageSize);
+
+    class SubpixelContourExtractor
+    {
+    public:
+        SubpixelContourExtractor();
+        ~SubpixelContourExtractor();
+        SubpixelContourExtractor(const SubpixelContourExtractor &) = delete;
+        SubpixelContourExtractor &operator=(const SubpixelContourExtractor &) = delete;
+
+        // Closed curves in input coordinates enclosing at least minAreaFraction of the image,
+        // largest first. If no chain closes and minAreaFraction <= 0, the longest open chain is
+        // returned on its own. Safe to call concurrently: each call runs on a detector of its own.
+        std::vector<std::vector<cv::Point2d>> extract(const cv::Mat &image, const ContourParams &params,
+                                                      double minAreaFraction);
+
+        // Pool the detector's row and column loops run on; null runs them on the calling thread
+        void setThreadPool(std::shared_ptr<parallel::ThreadPool> pool);
+
+    private:
+        // The detector's maps (4x the image) are reused by later calls of the same image size
+        struct Detector
+        {
+            cv::Size size;
+            std::unique_ptr<ThirdOrderEdgeDetectionCPU> toed;
+        };
+
+        Detector acquireDetector(cv::Size size);
+        void releaseDetector(Detector detector);
+
+        // Guards pool_ and idle_ only; detection runs unlocked
+        std::mutex mutex_;
+        std::shared_ptr<parallel::ThreadPool> pool_;
+        std::vector<Detector> idle_;
+    };
+
+} // namespace css
+
+#endif // SUBPIXEL_CONTOUR_H
@@ -0,0 +1,138 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "ExecutionContext.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// =======================================================================================================
+// ThreadPool: Fixed-size work-stealing pool shared by recognition, CSS and TOED
+//
+// Every worker owns a task deque. Tasks submitted by a worker go to the back of its own deque and
+// are run newest first; tasks from other threads go to a shared injection queue. A worker with
+// nothing left takes from the injection queue, then steals the oldest task of another worker.
+//
+// parallelFor is the loop primitive: chunks of the range are claimed one at a time from a shared
+// counter by the caller and by helper tasks that idle workers steal, so uneven chunks balance
+// themselves. A parallelFor inside a task, e.g. the scales of a descriptor built for one database
+// image, reuses the same workers instead of starting threads of its own. Because the caller keeps
+// claiming chunks until none are left, a loop completes even if no worker ever picks up a helper;
+// the caller only runs chunks of its own loop and never unrelated tasks. Holding a lock across
+// parallelFor is still only safe if body does not take that lock. Built from an ExecutionContext,
+// workers are pinned to its CPUs; chunks run by a non-worker caller run on the caller's CPU. A
+// thread that is already one of many concurrent units of work, such as a server request handler,
+// opens a SerialScope so its loops run on it alone instead of adding helpers on the same CPUs.
+//
+// ChangeLogs
+//    Oct 18, 2026    Created for sharded database search
+//    Oct 18, 2026    Sized and pinned from an ExecutionContext
+//    Oct 18, 2026    Work-stealing deques and parallelFor replace the OpenMP loops
+//    Oct 18, 2026    Non-worker callers of parallelFor run chunks too
+//    Oct 18, 2026    SerialScope for callers that are themselves run concurrently
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace parallel
+{
+
+    class ThreadPool
+    {
+    public:
+        // numThreads = 0 uses one worker per available CPU
+        explicit ThreadPool(size_t numThreads = 0);
+        explicit ThreadPool(const ExecutionContext &context);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        size_t size() const { return queues_.size() - 1; }
+        const ExecutionContext &context() const { return context_; }
+
+        // True on the workers of this pool
+        bool isWorker() const;
+
+        template <typename F>
+        auto submit(F &&task) -> std::future<typename std::invoke_result<F>::type>
+        {
+            using R = typename std::invoke_result<F>::type;
+            auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+            std::future<R> result = packaged->get_future();
+            schedule([packaged]()
+                     { (*packaged)(); });
+            return result;
+        }
+
+        // Calls body(chunkBegin, chunkEnd) for consecutive chunks of at most grain indices covering
+        // [begin, end) and returns once all of them have run. Must not be waited on through a
+        // future from inside a task of this pool; nested parallelFor calls are fine. The first
+        // exception thrown by body is rethrown here after the remaining chunks have run.
+        void parallelFor(size_t begin, size_t end, size_t grain,
+                         const std::function<void(size_t, size_t)> &body);
+
+    private:
+        struct WorkQueue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        void schedule(std::function<void()> task);
+        bool runOne(size_t index);
+        void workerLoop(size_t index);
+
+        ExecutionContext context_;
+
+        // One deque per worker, then the injection queue; complete before any worker starts
+        std::vector<std::unique_ptr<WorkQueue>> queues_;
+        std::vector<std::thread> workers_;
+
+        // Idle workers sleep until queued_ > 0; it is raised under mutex_ so no wake-up is lost
+        std::atomic<size_t> queued_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool stopping_;
+    };
+
+    // While alive, every parallelFor started on the constructing thread, on any pool, is one call of
+    // body over the whole range. Scopes nest; destroy on the thread that created it.
+    class SerialScope
+    {
+    public:
+        SerialScope();
+        ~SerialScope();
+
+        SerialScope(const SerialScope &) = delete;
+        SerialScope &operator=(const SerialScope &) = delete;
+
+    private:
+        bool previous_;
+    };
+
+    // parallelFor on pool, or one serial call of body over the whole range when pool is null
+    inline void parallelFor(ThreadPool *pool, size_t begin, size_t end, size_t grain,
+                            const std::function<void(size_t, size_t)> &body)
+    {
+        if (pool)
+        {
+            pool->parallelFor(begin, end, grain, body);
+        }
+        else if (begin < end)
+        {
+            body(begin, end);
+        }
+    }
+
+} // namespace parallel
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,88 @@
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// =======================================================================================================
+// TopK: Bounded max-heap that keeps the K lowest-scoring items seen so far
+//
+// Each search task fills its own TopK; partial results are combined with merge() and read out
+// in ascending score order with sorted().
+//
+// ChangeLogs
+//    Oct 18, 2026    Created for sharded database search
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace recognition
+{
+
+    template <typename T>
+    class TopK
+    {
+    public:
+        using Item = std::pair<double, T>; // (score, value)
+
+        explicit TopK(size_t k) : k_(k) { heap_.reserve(std::min<size_t>(k, 1024)); }
+
+        size_t capacity() const { return k_; }
+        size_t size() const { return heap_.size(); }
+        bool full() const { return heap_.size() >= k_; }
+
+        // Largest score currently kept; anything not below it is rejected once full
+        double worstScore() const
+        {
+            return full() && !heap_.empty() ? heap_.front().first : std::numeric_limits<double>::max();
+        }
+
+        bool accepts(double score) const { return !full() || score < heap_.front().first; }
+
+        void push(double score, T value)
+        {
+            if (k_ == 0 || !accepts(score))
+            {
+                return;
+            }
+
+            if (full())
+            {
+                std::pop_heap(heap_.begin(), heap_.end(), compare);
+                heap_.pop_back();
+            }
+            heap_.emplace_back(score, std::move(value));
+            std::push_heap(heap_.begin(), heap_.end(), compare);
+        }
+
+        void merge(TopK &&other)
+        {
+            for (auto &item : other.heap_)
+            {
+                push(item.first, std::move(item.second));
+            }
+            other.heap_.clear();
+        }
+
+        // Items in ascending score order; leaves the heap empty
+        std::vector<Item> sorted()
+        {
+            std::sort_heap(heap_.begin(), heap_.end(), compare);
+            std::vector<Item> out = std::move(heap_);
+            heap_.clear();
+            return out;
+        }
+
+    private:
+        static bool compare(const Item &a, const Item &b) { return a.first < b.first; }
+
+        size_t k_;
+        std::vector<Item> heap_;
+    };
+
+} // namespace recognition
+
+#endif // TOP_K_H
@@ -0,0 +1,110 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// =======================================================================================================
+// Tracing: Per-thread event timeline exported in Chrome trace format (chrome://tracing, Perfetto)
+//
+// Where Profiling.h sums time per stage, a trace keeps every span with its thread, so it shows how
+// work lands on the workers and where the long tail of a query goes. Each thread appends complete
+// events to its own ring buffer; when a buffer is full the oldest events are overwritten. The
+// first span a thread records in a trace allocates its buffer (eventsPerThread events, ~40 bytes
+// each) and takes a lock to register it; every later append is lock-free and allocation-free.
+// Spans inside hot loops should cover a chunk of iterations, not one, so the ring is not flooded.
+// Build with -DCSS_TRACING=1 (CMake option CSS_TRACING) to compile the macros in, then record
+// between start() and stop():
+//
+//    CSS_TRACE_SCOPE("recognition.match");                  // span until the end of the block
+//    CSS_TRACE_SCOPE_ARG("css.scale", "scale", i);          // span with one integer argument
+//
+// Without CSS_TRACING the macros compile to nothing; with it, a span costs one relaxed load while
+// tracing is stopped.
+//
+// ChangeLogs
+//    Oct 18, 2026    Created for tail latency analysis of multithreaded runs
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+#ifndef CSS_TRACING
+#define CSS_TRACING 0
+#endif
+
+namespace tracing
+{
+
+    struct Event
+    {
+        const char *name;    // string literal, never copied
+        const char *argName; // nullptr: no argument
+        int64_t arg;
+        uint64_t startNs;    // since the trace clock epoch
+        uint64_t durationNs;
+    };
+
+    constexpr bool compiledIn() { return CSS_TRACING != 0; }
+
+    // Clears previous events and begins recording; eventsPerThread is the ring buffer size
+    void start(size_t eventsPerThread = 1 << 16);
+    void stop();
+
+    namespace detail
+    {
+        extern std::atomic<bool> g_active;
+        void append(const Event &event);
+        uint64_t nowNs();
+    }
+
+    inline bool active() { return detail::g_active.load(std::memory_order_relaxed); }
+
+    // Writes the recorded events as Chrome trace JSON. Call after stop(), once traced work has
+    // finished; buffers are read without synchronizing with writers.
+    bool writeChromeTrace(const std::string &filepath);
+    size_t eventCount();
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name, const char *argName = nullptr, int64_t arg = 0)
+            : name_(name), argName_(argName), arg_(arg), startNs_(active() ? detail::nowNs() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (startNs_ != 0 && active())
+            {
+                detail::append(Event{name_, argName_, arg_, startNs_, detail::nowNs() - startNs_});
+            }
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *name_;
+        const char *argName_;
+        int64_t arg_;
+        uint64_t startNs_; // 0: tracing was stopped when the span began
+    };
+
+} // namespace tracing
+
+#define CSS_TRACE_CONCAT_(a, b) a##b
+#define CSS_TRACE_CONCAT(a, b) CSS_TRACE_CONCAT_(a, b)
+
+#if CSS_TRACING
+#define CSS_TRACE_SCOPE(name) tracing::Scope CSS_TRACE_CONCAT(css_trace_scope_, __LINE__)(name)
+#define CSS_TRACE_SCOPE_ARG(name, argName, value) \
+    tracing::Scope CSS_TRACE_CONCAT(css_trace_scope_, __LINE__)(name, argName, static_cast<int64_t>(value))
+#else
+#define CSS_TRACE_SCOPE(name) ((void)0)
+#define CSS_TRACE_SCOPE_ARG(name, argName, value) ((void)0)
+#endif
+
+#endif // TRACING_H
@@ -0,0 +1,79 @@
+#ifndef VERIFICATION_H
+#define VERIFICATION_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// =======================================================================================================
+// Verification: Golden-output checks of the optimized kernels against reference implementations
+//
+// Every kernel with a faster variant is run next to a plain scalar reference on the same generated
+// inputs, and each output array is compared element-wise:
+//    derivatives   CSS::computeDerivativesWithGaussian vs. a long double direct convolution,
+//                  and the curvature computed from each
+//    distance      the zero-crossing toedDistance (unbounded and bounded) vs. the sequence form
+//    convolution   TOED convolve_img vs. a direct convolution with closed-form Gaussian derivative
+//                  kernels, and on a thread pool vs. serially (Ix, Iy, magnitude, orientation)
+//    descriptor    CSS::computeCSS with scales on a thread pool vs. serially
+// A new variant of one of these kernels gets its comparison added here; `css_recognition_app
+// verify` runs them all and is registered as a ctest test.
+//
+// ChangeLogs
+//    Oct 18, 2026    Created to keep kernel optimizations safe to enable
+//    Oct 18, 2026    Pooled TOED rows and descriptor scales against their serial runs
+//    Oct 18, 2026    TOED convolution against an independent scalar reference
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace verification
+{
+
+    // Error of one output array of one variant against the reference
+    struct ArrayError
+    {
+        std::string kernel;
+        std::string array;
+        size_t size = 0;
+        double maxError = 0.0;
+        double meanError = 0.0;
+        double tolerance = 0.0;
+        bool relative = false; // errors divided by max(1, |reference|)
+
+        bool passed() const { return maxError <= tolerance; }
+    };
+
+    struct VerificationReport
+    {
+        std::vector<ArrayError> arrays;
+
+        bool passed() const;
+        std::string format() const; // one aligned line per array
+    };
+
+    // Element-wise comparison; arrays of different sizes fail with an infinite error. Equal
+    // values, including equal infinities, count as zero error.
+    ArrayError compareArrays(const std::string &kernel, const std::string &array,
+                             const std::vector<double> &reference, const std::vector<double> &candidate,
+                             double tolerance, bool relative = false);
+
+    // Reference kernels: direct, scalar, no shortcuts
+    void referenceDerivatives(const std::vector<cv::Point2d> &contour, double sigma,
+                              std::vector<double> &dx, std::vector<double> &dy,
+                              std::vector<double> &d2x, std::vector<double> &d2y);
+    std::vector<double> curvature(const std::vector<double> &dx, const std::vector<double> &dy,
+                                  const std::vector<double> &d2x, const std::vector<double> &d2y);
+
+    // Append the comparisons of one kernel family, on inputs generated from seed
+    void verifyDerivatives(VerificationReport &report, unsigned seed);
+    void verifyDistances(VerificationReport &report, unsigned seed);
+    void verifyConvolution(VerificationReport &report, unsigned seed);
+    void verifyDescriptors(VerificationReport &report, unsigned seed);
+
+    VerificationReport verifyKernels(unsigned seed = 1);
+
+} // namespace verification
+
+#endif // VERIFICATION_H
@@ -0,0 +1,153 @@
+#ifndef VIDEO_PIPELINE_H
+#define VIDEO_PIPELINE_H
+
+#include "BoundedQueue.h"
+#include "Recognition.h"
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// =======================================================================================================
+// VideoPipeline: Continuous recognition of a video stream
+//
+// Capture, contour extraction, CSS computation and database matching each run on their own thread,
+// connected by bounded queues, so a frame is being matched while the next ones are extracted and
+// described. When a stage falls behind, the queues in front of it drop their oldest frames: results
+// describe the newest frame the pipeline could keep up with instead of an ever-growing backlog.
+// Sources are camera indices or video file paths; files can also be processed frame by frame.
+//
+// Consecutive frames of a steady scene yield nearly the same silhouette. A cheap moment signature
+// of each extracted contour decides whether the CSS descriptor and matches of the last described
+// frame still apply, so only frames where the object actually changes pay for CSS and matching.
+//
+// ChangeLogs
+//    Oct 18, 2026    Created for streaming video recognition
+//    Oct 18, 2026    Temporal reuse of descriptors and warm-started matching
+//    Oct 18, 2026    start() after stop() reopens the queues
+//    Oct 18, 2026    Frames counted as processed when delivered, not when matched
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+namespace recognition
+{
+
+    struct PipelineOptions
+    {
+        int topK = 3;
+        size_t queueCapacity = 2;    // frames buffered in front of each stage
+        bool dropStaleFrames = true; // false: every frame is processed, stages wait for each other
+        bool paceToFrameRate = true; // read video files at their frame rate rather than as fast as possible
+
+        // Temporal coherence: while the contour's log-Hu moment signature stays within
+        // reuseTolerance of the last described frame, its descriptor and matches are reused;
+        // when it changes, matching is warm-started from the previous top-K
+        bool temporalReuse = true;
+        double reuseTolerance = 0.05;
+    };
+
+    // Wall time in milliseconds; latency runs from the end of capture to the end of matching
+    struct StageTimings
+    {
+        double capture = 0.0;
+        double extract = 0.0;
+        double describe = 0.0;
+        double match = 0.0;
+        double latency = 0.0;
+    };
+
+    // One frame as it travels through the pipeline
+    struct FrameResult
+    {
+        uint64_t frameIndex = 0;
+        cv::Mat frame;
+        bool found = false;  // a contour was extracted
+        bool reused = false; // descriptor taken over from an earlier frame
+        QueryShape query;
+        css::CSSImage descriptor;
+        uint64_t descriptorId = 0; // frames sharing a descriptor share its id
+        std::vector<ShapeEntry> matches;
+        StageTimings timings;
+        std::chrono::steady_clock::time_point captured;
+    };
+
+    struct PipelineStats
+    {
+        uint64_t framesCaptured = 0;
+        uint64_t framesProcessed = 0; // frames handed out by nextResult
+        uint64_t framesDropped = 0;   // stale frames discarded between stages
+        uint64_t framesReused = 0;    // processed frames whose CSS computation was skipped
+        StageTimings mean;
+        StageTimings last;
+    };
+
+    class VideoPipeline
+    {
+    public:
+        // The recognizer must outlive the pipeline and not be modified while it runs
+        explicit VideoPipeline(Recognition &recognizer, const PipelineOptions &options = PipelineOptions());
+        ~VideoPipeline();
+
+        VideoPipeline(const VideoPipeline &) = delete;
+        VideoPipeline &operator=(const VideoPipeline &) = delete;
+
+        // An all-digit source opens that camera, anything else a video file or stream URL. A
+        // stopped pipeline can be started again; stats then restart from zero.
+        bool start(const std::string &source);
+
+        // Blocks for the next processed frame; false once the source is exhausted and drained
+        bool nextResult(FrameResult &result);
+
+        // Stop all stages and discard frames still in flight
+        void stop();
+
+        bool isLive() const { return live_; }
+        PipelineStats stats() const;
+
+    private:
+        typedef parallel::BoundedQueue<FrameResult> FrameQueue;
+
+        void captureLoop();
+        void extractLoop();
+        void describeLoop();
+        void matchLoop();
+        void record(const FrameResult &result);
+
+        Recognition &recognizer_;
+        PipelineOptions options_;
+
+        cv::VideoCapture capture_;
+        bool live_;
+        double sourceFps_;
+
+        FrameQueue captured_;  // capture -> extract
+        FrameQueue extracted_; // extract -> describe
+        FrameQueue described_; // describe -> match
+        FrameQueue results_;   // match -> nextResult
+
+        // Temporal reuse state, each owned by its stage thread
+        std::array<double, 4> referenceSignature_;
+        css::CSSImage referenceDescriptor_;
+        uint64_t referenceId_;
+        uint64_t nextDescriptorId_;
+        uint64_t matchedId_;
+        std::vector<ShapeEntry> lastMatches_;
+
+        std::atomic<bool> stopping_;
+        std::vector<std::thread> threads_;
+
+        mutable std::mutex statsMutex_;
+        PipelineStats stats_;
+        StageTimings totals_;
+    };
+
+} // namespace recognition
+
+#endif // VIDEO_PIPELINE_H
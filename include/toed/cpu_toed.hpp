@@ -9,7 +9,6 @@
 #include <vector>
 
 #include "indices.hpp"
-#include <omp.h>
 #include <opencv2/opencv.hpp>
 
 // =======================================================================================================
@@ -18,11 +17,23 @@
 // ChangeLogs
 //    Chien  25-02-08    Imported from the original third-order edge detector.
 //    Jue    25-06-17    Modified for an edge-based structure.
+//    Jue    26-10-18    std::hash<Edge> hashes the members operator== compares; index initialized.
+//    Jue    26-10-18    Read-only accessors for the convolution outputs (kernel verification).
+//    Jue    26-10-18    omp_threads applies to each parallel region instead of the global OpenMP
+//                       state; omp_cpus pins the OpenMP threads.
+//    Jue    26-10-18    Convolution rows and NMS columns run as chunks on the owner's thread pool
+//                       instead of OpenMP loops.
+//    Jue    26-10-18    No OpenMP dependency left; stage timings use std::chrono.
 //
 //> (c) LEMS, Brown University
 //> Chiang-Heng Chien (chiang-heng_chien@brown.edu)
 // =======================================================================================================
 
+namespace parallel
+{
+    class ThreadPool;
+}
+
 struct Edge
 {
     cv::Point2d location; //> x, y location of the edge point
@@ -31,8 +42,8 @@ struct Edge
     bool b_isEmpty;   //> check if this struct is value-assigned
     int frame_source; //> which frame this edge comes from
     int index;        //> index of the edge in the original edge list
-    Edge() : location(cv::Point2d(-1.0, -1.0)), orientation(-100), b_isEmpty(true), frame_source(-1) {}
-    Edge(cv::Point2d location, double orientation, bool b_isEmpty, int frame_source) : location(location), orientation(orientation), b_isEmpty(b_isEmpty), frame_source(frame_source) {}
+    Edge() : location(cv::Point2d(-1.0, -1.0)), orientation(-100), b_isEmpty(true), frame_source(-1), index(-1) {}
+    Edge(cv::Point2d location, double orientation, bool b_isEmpty, int frame_source) : location(location), orientation(orientation), b_isEmpty(b_isEmpty), frame_source(frame_source), index(-1) {}
 
     bool operator==(const Edge &other) const
     {
@@ -54,15 +65,10 @@ namespace std
     {
         size_t operator()(const Edge &edge) const
         {
-            // Combine hash values of all members
-            size_t h1 = hash<double>()(edge.location.x);
-            size_t h2 = hash<double>()(edge.location.y);
-            size_t h3 = hash<double>()(edge.orientation);
-            size_t h4 = hash<bool>()(edge.b_isEmpty);
-            size_t h5 = hash<int>()(edge.frame_source);
-
-            // Simple hash combination
-            return h1 ^ (h2 << 1) ^ (h3 << 2) ^ (h4 << 3) ^ (h5 << 4);
+            //> Hash exactly the members operator== compares, so equal edges always hash equally
+            size_t h1 = hash<int>()(edge.frame_source);
+            size_t h2 = hash<int>()(edge.index);
+            return h1 ^ (h2 + 0x9e3779b97f4a7c15ULL + (h1 << 6) + (h1 >> 2));
         }
     };
 }
@@ -93,7 +99,7 @@ public:
     double *subpix_edge_pts_final; //> a list of final edge points with all information (Nx4 array, where N is the number of third-order edges)
     int edge_pt_list_idx;
     int num_of_edge_data;
-    int omp_threads;
+    parallel::ThreadPool *pool; //> runs the row/column chunks, set by the owner; nullptr: serial
 
     //> timings
     double time_conv, time_nms;
@@ -107,6 +113,14 @@ public:
     void convolve_img();
     int non_maximum_suppresion();
 
+    //> read-only convolution outputs, interp_img_height x interp_img_width, row-major
+    const double *get_Ix() const { return Ix; }
+    const double *get_Iy() const { return Iy; }
+    const double *get_I_grad_mag() const { return I_grad_mag; }
+    const double *get_I_orient() const { return I_orient; }
+    int get_interp_img_height() const { return interp_img_height; }
+    int get_interp_img_width() const { return interp_img_width; }
+
     void read_array_from_file(std::string filename, double *rd_data, int first_dim, int second_dim);
     void write_array_to_file(std::string filename, double *wr_data, int first_dim, int second_dim);
 
@@ -1,4 +1,8 @@
 //> Macro definitions
+#include "Logging.h"
+#include "Profiling.h"
+#include "Tracing.h"
+
 // USE_GLOGS is now defined by CMake based on glog/gflags availability
 #ifndef USE_GLOGS
 #define USE_GLOGS (false)
@@ -6,12 +10,9 @@
 
 #define USE_CPP17 (true)
 
-//> OpenMP settings
-#define ACTIVATE_OPENMP_SUPPORT (true)
-#define USE_DEFINED_NUM_OF_CORES (false)
-#if USE_DEFINED_NUM_OF_CORES
-#define USE_NUM_CORES_FOR_OMP (8)
-#endif
+//> Parallel settings: image rows (convolution) and interpolated columns (NMS) per pool task
+#define TOED_ROWS_PER_TASK (4)
+#define TOED_COLS_PER_TASK (16)
 
 //> Stereo edge matching settings
 #define EPIP_TENGENCY_ORIENT_THRESH (12) //> in degrees
@@ -36,8 +37,6 @@
 #define PYRAMID_LEVELS (4) //> Number of pyramid levels for optical flow
 #define GRID_SIZE (10)     //> Size of the spatial grid cells in pixels
 
-#define MEASURE_TIMINGS (false)
-
 //> For quick processing
 #define WRITE_TOED_EDGES (true)
 #define READ_TOED_EDGES_FROM_FILES (false)
@@ -79,12 +78,12 @@
 #define LOWES_RATIO (0.8) //> Suggested in Lowe's paper
 #define K_IN_KNN_MATCHING (2)
 
-//> Print outs
-#define LOG_INFO(info_msg) printf("\033[1;32m[INFO] %s\033[0m\n", std::string(info_msg).c_str());
-#define LOG_STATUS(status_) printf("\033[1;35m[STATUS] %s\033[0m\n", std::string(status_).c_str());
-#define LOG_ERROR(err_msg) printf("\033[1;31m[ERROR] %s\033[0m\n", std::string(err_msg).c_str());
-#define LOG_TEST(test_msg) printf("\033[1;30m[TEST] %s\033[0m\n", std::string(test_msg).c_str());
-#define LOG_FILE_ERROR(err_msg) printf("\033[1;31m[ERROR] File %s not found!\033[0m\n", std::string(err_msg).c_str());
+//> Print outs, routed through the shared leveled logger (Logging.h)
+#define LOG_INFO(info_msg) CSS_LOG_INFO(std::string(info_msg));
+#define LOG_STATUS(status_) CSS_LOG_INFO(std::string(status_));
+#define LOG_ERROR(err_msg) CSS_LOG_ERROR(std::string(err_msg));
+#define LOG_TEST(test_msg) CSS_LOG_DEBUG(std::string(test_msg));
+#define LOG_FILE_ERROR(err_msg) CSS_LOG_ERROR("File " << std::string(err_msg) << " not found!");
 #define LOG_PRINT_HELP_MESSAGE printf("Usage: ./main_VO [flag] [argument]\n\n"                 \
                                       "options:\n"                                             \
                                       "  -h, --help         show this help message and exit\n" \
@@ -0,0 +1,88 @@
+#ifndef EDGE_GRID_HPP
+#define EDGE_GRID_HPP
+
+#include <cmath>
+#include <vector>
+
+#include "cpu_toed.hpp"
+#include "definitions.h"
+
+// =======================================================================================================
+// class EdgeGrid: Bucketed spatial index over a list of edges
+//
+// Edges are counting-sorted into square cells (one pass, no per-cell allocation), so the edges near
+// a point are found by scanning the few cells overlapping the query disc. Building is O(E + cells)
+// and a query with radius ~ cell size is O(1) on average, which keeps edge linking and clustering
+// linear in the number of edges instead of O(E^2).
+//
+// ChangeLogs
+//    Jue    26-10-18    Created for edge linking and clustering of TOED edges.
+//
+//> (c) LEMS, Brown University
+//> Jue Han (jhan192@brown.edu)
+// =======================================================================================================
+
+class EdgeGrid
+{
+public:
+    EdgeGrid(int img_height, int img_width, double cell_size = GRID_SIZE);
+
+    //> bucket the edges; the edge list must outlive queries on the grid
+    void build(const std::vector<Edge> &edges);
+
+    //> call f(edge_index) for every edge within radius of p
+    template <typename F>
+    void for_each_neighbor(const cv::Point2d &p, double radius, F &&f) const
+    {
+        const int x0 = std::max(0, static_cast<int>((p.x - radius) / cell_size));
+        const int y0 = std::max(0, static_cast<int>((p.y - radius) / cell_size));
+        const int x1 = std::min(grid_cols - 1, static_cast<int>((p.x + radius) / cell_size));
+        const int y1 = std::min(grid_rows - 1, static_cast<int>((p.y + radius) / cell_size));
+        const double r2 = radius * radius;
+
+        for (int gy = y0; gy <= y1; gy++)
+        {
+            for (int gx = x0; gx <= x1; gx++)
+            {
+                const int cell = gy * grid_cols + gx;
+                for (int k = cell_start[cell]; k < cell_start[cell + 1]; k++)
+                {
+                    const int idx = cell_edges[k];
+                    const double dx = (*edges)[idx].location.x - p.x;
+                    const double dy = (*edges)[idx].location.y - p.y;
+                    if (dx * dx + dy * dy <= r2)
+                    {
+                        f(idx);
+                    }
+                }
+            }
+        }
+    }
+
+    //> indices of edges within radius of p
+    std::vector<int> query(const cv::Point2d &p, double radius) const;
+
+    int rows() const { return grid_rows; }
+    int cols() const { return grid_cols; }
+
+private:
+    int cell_index(const cv::Point2d &p) const;
+
+    double cell_size;
+    int grid_rows;
+    int grid_cols;
+
+    const std::vector<Edge> *edges;
+    std::vector<int> cell_start; //> CSR offsets, (grid_rows * grid_cols + 1) entries
+    std::vector<int> cell_edges; //> edge indices ordered by cell
+};
+
+//> Merge edges closer than dist_thresh (pixels) whose orientations differ by less than
+//> orient_thresh (degrees) into one edge at their mean location and orientation. At most
+//> max_cluster_size edges are merged per cluster. Linear in the number of edges.
+std::vector<Edge> cluster_edges(const std::vector<Edge> &edges, const EdgeGrid &grid,
+                                double dist_thresh = CLUSTER_DIST_THRESH,
+                                double orient_thresh = CLUSTER_ORIENT_THRESH,
+                                int max_cluster_size = MAX_CLUSTER_SIZE);
+
+#endif // EDGE_GRID_HPP
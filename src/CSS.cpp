@@ -1,4 +1,9 @@
 #include "CSS.h"
+#include "Logging.h"
+#include "Profiling.h"
+#include "Tracing.h"
+#include "SubpixelContour.h"
+#include "ThreadPool.h"
 #include <cmath>
 #include <algorithm>
 #include <iostream>
@@ -7,14 +12,32 @@
 namespace css
 {
 
-    CSS::CSS() : cannyLow_(50), cannyHigh_(150), gaussianKernelSize_(5) {}
+    bool ContourParams::operator==(const ContourParams &other) const
+    {
+        return blurKernelSize == other.blurKernelSize &&
+               adaptiveBlockSize == other.adaptiveBlockSize &&
+               adaptiveC == other.adaptiveC &&
+               morphKernelSize == other.morphKernelSize &&
+               cannyLow == other.cannyLow &&
+               cannyHigh == other.cannyHigh &&
+               maxDimension == other.maxDimension &&
+               source == other.source;
+    }
+
+    CSS::CSS() : subpixelExtractor_(std::make_shared<SubpixelContourExtractor>()) {}
 
     CSS::~CSS() {}
 
+    void CSS::setThreadPool(std::shared_ptr<parallel::ThreadPool> pool)
+    {
+        pool_ = pool;
+        subpixelExtractor_->setThreadPool(std::move(pool));
+    }
+
     void CSS::setEdgeDetectionParams(double lowThresh, double highThresh)
     {
-        cannyLow_ = lowThresh;
-        cannyHigh_ = highThresh;
+        contourParams_.cannyLow = lowThresh;
+        contourParams_.cannyHigh = highThresh;
     }
 
     // ============================================================================
@@ -23,60 +46,199 @@ namespace css
 
     std::vector<cv::Point> CSS::extractContour(const cv::Mat &image)
     {
-        cv::Mat gray, binary, edges;
+        thread_local ExtractionContext ctx;
+        return extractContour(image, ctx);
+    }
+
+    std::vector<cv::Point> CSS::extractContour(const cv::Mat &image, ExtractionContext &ctx)
+    {
+        CSS_PROFILE_SCOPE("css.extract");
+        CSS_TRACE_SCOPE("css.extract");
+        cv::Point2d scale;
+        std::vector<std::vector<cv::Point>> &contours = findCandidateContours(image, ctx, scale);
 
-        // Convert to grayscale if needed
-        if (image.channels() == 3)
+        // Return the largest contour
+        if (contours.empty())
         {
-            cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+            CSS_LOG_DEBUG("No contours found!");
+            CSS_LOG_COUNT("css.extract.no_contour", 1);
+            return std::vector<cv::Point>();
         }
-        else
+
+        CSS_LOG_DEBUG("Found " << contours.size() << " contours");
+        CSS_LOG_COUNT("css.extract.calls", 1);
+        CSS_LOG_COUNT("css.extract.contours_found", contours.size());
+
+        // Single pass, one contourArea per candidate. A closed chain of n unit or diagonal steps
+        // has perimeter <= n*sqrt(2), so its area is at most n^2 / (2*pi) (isoperimetric bound);
+        // contours whose bound cannot beat the current best are skipped without computing it.
+        size_t largest = 0;
+        double largestArea = -1.0;
+        for (size_t i = 0; i < contours.size(); i++)
         {
-            gray = image.clone();
+            const double n = static_cast<double>(contours[i].size());
+            if (n * n / (2.0 * CV_PI) <= largestArea)
+            {
+                continue;
+            }
+
+            const double area = cv::contourArea(contours[i]);
+            if (area > largestArea)
+            {
+                largestArea = area;
+                largest = i;
+            }
+        }
+
+        CSS_LOG_DEBUG("Largest contour area: " << largestArea);
+
+        std::vector<cv::Point> result = std::move(contours[largest]);
+        mapToInput(result, scale);
+        return result;
+    }
+
+    std::vector<std::vector<cv::Point>> CSS::extractContours(const cv::Mat &image, double minAreaFraction)
+    {
+        thread_local ExtractionContext ctx;
+        return extractContours(image, minAreaFraction, ctx);
+    }
+
+    std::vector<std::vector<cv::Point>> CSS::extractContours(const cv::Mat &image, double minAreaFraction,
+                                                             ExtractionContext &ctx)
+    {
+        CSS_PROFILE_SCOPE("css.extract");
+        cv::Point2d scale;
+        std::vector<std::vector<cv::Point>> &contours = findCandidateContours(image, ctx, scale);
+        CSS_LOG_COUNT("css.extract.calls", 1);
+        CSS_LOG_COUNT("css.extract.contours_found", contours.size());
+
+        // Threshold in the (possibly downscaled) working image
+        const double minArea = minAreaFraction * image.rows * image.cols / (scale.x * scale.y);
+
+        // Same isoperimetric bound as extractContour rejects small chains without contourArea
+        std::vector<std::pair<double, size_t>> kept;
+        for (size_t i = 0; i < contours.size(); i++)
+        {
+            const double n = static_cast<double>(contours[i].size());
+            if (n * n / (2.0 * CV_PI) < minArea)
+            {
+                continue;
+            }
+
+            const double area = cv::contourArea(contours[i]);
+            if (area >= minArea)
+            {
+                kept.push_back({area, i});
+            }
+        }
+
+        // Largest first
+        std::sort(kept.begin(), kept.end(), [](const std::pair<double, size_t> &a, const std::pair<double, size_t> &b)
+                  { return a.first > b.first; });
+
+        std::vector<std::vector<cv::Point>> result;
+        result.reserve(kept.size());
+        for (const auto &k : kept)
+        {
+            result.push_back(std::move(contours[k.second]));
+            mapToInput(result.back(), scale);
+        }
+
+        CSS_LOG_DEBUG("Kept " << result.size() << " of " << contours.size() << " contours");
+        return result;
+    }
+
+    std::vector<cv::Point2d> CSS::extractSubpixelContour(const cv::Mat &image)
+    {
+        CSS_PROFILE_SCOPE("css.extract_subpixel");
+        std::vector<std::vector<cv::Point2d>> curves = subpixelExtractor_->extract(image, contourParams_, 0.0);
+        if (curves.empty())
+        {
+            CSS_LOG_DEBUG("No subpixel contour found!");
+            CSS_LOG_COUNT("css.extract.no_contour", 1);
+            return std::vector<cv::Point2d>();
+        }
+        return std::move(curves.front());
+    }
+
+    std::vector<std::vector<cv::Point2d>> CSS::extractSubpixelContours(const cv::Mat &image, double minAreaFraction)
+    {
+        CSS_PROFILE_SCOPE("css.extract_subpixel");
+        return subpixelExtractor_->extract(image, contourParams_, minAreaFraction);
+    }
+
+    std::vector<std::vector<cv::Point>> &CSS::findCandidateContours(const cv::Mat &image, ExtractionContext &ctx,
+                                                                    cv::Point2d &scale)
+    {
+        // Downscale large inputs (e.g. phone photos); contours are mapped back by the caller
+        const cv::Mat *gray = &image;
+        scale = cv::Point2d(1.0, 1.0);
+        const int maxDimension = contourParams_.maxDimension;
+        if (maxDimension > 0 && std::max(image.rows, image.cols) > maxDimension)
+        {
+            const double factor = maxDimension / static_cast<double>(std::max(image.rows, image.cols));
+            cv::Size newSize(std::max(1, cvRound(image.cols * factor)), std::max(1, cvRound(image.rows * factor)));
+            cv::resize(image, ctx.scaled, newSize, 0, 0, cv::INTER_AREA);
+            scale.x = image.cols / static_cast<double>(newSize.width);
+            scale.y = image.rows / static_cast<double>(newSize.height);
+            gray = &ctx.scaled;
+            CSS_LOG_COUNT("css.extract.downscaled", 1);
+        }
+
+        // Convert to grayscale if needed; grayscale input is read in place
+        if (gray->channels() == 3)
+        {
+            cv::cvtColor(*gray, ctx.gray, cv::COLOR_BGR2GRAY);
+            gray = &ctx.gray;
         }
 
         // Apply Gaussian blur
-        cv::GaussianBlur(gray, gray, cv::Size(5, 5), 0);
+        const int blurSize = contourParams_.blurKernelSize;
+        cv::GaussianBlur(*gray, ctx.blurred, cv::Size(blurSize, blurSize), 0);
 
         // Try adaptive thresholding first to get binary image
-        cv::adaptiveThreshold(gray, binary, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C,
-                              cv::THRESH_BINARY_INV, 11, 2);
+        cv::adaptiveThreshold(ctx.blurred, ctx.binary, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C,
+                              cv::THRESH_BINARY_INV, contourParams_.adaptiveBlockSize,
+                              contourParams_.adaptiveC);
 
         // Apply morphological operations to close gaps
-        cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3));
-        cv::morphologyEx(binary, binary, cv::MORPH_CLOSE, kernel);
+        const int morphSize = contourParams_.morphKernelSize;
+        if (ctx.kernel.empty() || ctx.kernelSize != morphSize)
+        {
+            ctx.kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(morphSize, morphSize));
+            ctx.kernelSize = morphSize;
+        }
+        cv::morphologyEx(ctx.binary, ctx.binary, cv::MORPH_CLOSE, ctx.kernel);
 
         // Find contours on binary image
-        std::vector<std::vector<cv::Point>> contours;
-        cv::findContours(binary, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
+        std::vector<std::vector<cv::Point>> &contours = ctx.contours;
+        cv::findContours(ctx.binary, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
 
         // If no contours found with thresholding, try Canny as fallback
         if (contours.empty())
         {
-            std::cout << "Binary thresholding failed, trying Canny edge detection..." << std::endl;
-            cv::Canny(gray, edges, cannyLow_, cannyHigh_);
-            cv::findContours(edges, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
+            CSS_LOG_DEBUG("Binary thresholding failed, trying Canny edge detection...");
+            CSS_LOG_COUNT("css.extract.canny_fallback", 1);
+            cv::Canny(ctx.blurred, ctx.edges, contourParams_.cannyLow, contourParams_.cannyHigh);
+            cv::findContours(ctx.edges, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
         }
 
-        // Return the largest contour
-        if (contours.empty())
+        return contours;
+    }
+
+    void CSS::mapToInput(std::vector<cv::Point> &contour, const cv::Point2d &scale)
+    {
+        if (scale.x == 1.0 && scale.y == 1.0)
         {
-            std::cerr << "Warning: No contours found!" << std::endl;
-            return std::vector<cv::Point>();
+            return;
         }
 
-        // Debug: print number of contours found
-        std::cout << "Found " << contours.size() << " contours" << std::endl;
-
-        auto largest = std::max_element(contours.begin(), contours.end(),
-                                        [](const std::vector<cv::Point> &a, const std::vector<cv::Point> &b)
-                                        {
-                                            return cv::contourArea(a) < cv::contourArea(b);
-                                        });
-
-        std::cout << "Largest contour area: " << cv::contourArea(*largest) << std::endl;
-
-        return *largest;
+        // Map pixel centres of the downscaled image back to input coordinates
+        for (auto &pt : contour)
+        {
+            pt.x = cvRound((pt.x + 0.5) * scale.x - 0.5);
+            pt.y = cvRound((pt.y + 0.5) * scale.y - 0.5);
+        }
     }
 
     // ============================================================================
@@ -209,13 +371,15 @@ namespace css
         }
     }
 
-    void CSS::computeDerivativesWithGaussian(const std::vector<cv::Point> &contour,
+    template <typename PointT>
+    void CSS::computeDerivativesWithGaussian(const std::vector<PointT> &contour,
                                              double sigma,
                                              std::vector<double> &dx,
                                              std::vector<double> &dy,
                                              std::vector<double> &d2x,
                                              std::vector<double> &d2y)
     {
+        CSS_PROFILE_SCOPE("css.smooth");
         int n = contour.size();
         dx.resize(n);
         dy.resize(n);
@@ -286,6 +450,13 @@ namespace css
         }
     }
 
+    template void CSS::computeDerivativesWithGaussian<cv::Point>(const std::vector<cv::Point> &, double,
+                                                                 std::vector<double> &, std::vector<double> &,
+                                                                 std::vector<double> &, std::vector<double> &);
+    template void CSS::computeDerivativesWithGaussian<cv::Point2d>(const std::vector<cv::Point2d> &, double,
+                                                                   std::vector<double> &, std::vector<double> &,
+                                                                   std::vector<double> &, std::vector<double> &);
+
     std::vector<double> CSS::computeCurvature(const std::vector<ContourPoint> &smoothedContour)
     {
         std::vector<double> dx, dy, d2x, d2y;
@@ -319,6 +490,7 @@ namespace css
 
     std::vector<int> CSS::findZeroCrossings(const std::vector<double> &curvature)
     {
+        CSS_PROFILE_SCOPE("css.zero_crossings");
         std::vector<int> crossings;
         int n = curvature.size();
 
@@ -344,74 +516,100 @@ namespace css
                              double maxSigma,
                              int numScales)
     {
+        return computeCSSImpl(contour, maxSigma, numScales);
+    }
+
+    CSSImage CSS::computeCSS(const std::vector<cv::Point2d> &contour,
+                             double maxSigma,
+                             int numScales)
+    {
+        return computeCSSImpl(contour, maxSigma, numScales);
+    }
+
+    template <typename PointT>
+    CSSImage CSS::computeCSSImpl(const std::vector<PointT> &contour,
+                                 double maxSigma,
+                                 int numScales)
+    {
+        CSS_PROFILE_SCOPE("css.descriptor");
         CSSImage css;
         css.maxSigma = maxSigma;
         css.numScales = numScales;
 
         if (contour.empty())
         {
-            std::cerr << "Error: Empty contour!" << std::endl;
+            CSS_LOG_ERROR("Empty contour!");
             return css;
         }
 
-        // Compute CSS at multiple scales using proper Gaussian convolution
-        for (int i = 0; i < numScales; i++)
-        {
-            double sigma = (i + 1) * maxSigma / numScales;
-
-            // Compute derivatives by convolving with Gaussian derivative kernels
-            std::vector<double> dx, dy, d2x, d2y;
-            computeDerivativesWithGaussian(contour, sigma, dx, dy, d2x, d2y);
-
-            // Compute arc length (approximate)
-            int n = contour.size();
-            std::vector<double> arcLength(n);
-            arcLength[0] = 0.0;
-            double totalLength = 0.0;
-
-            for (int j = 1; j < n; j++)
-            {
-                double ds = std::sqrt(dx[j - 1] * dx[j - 1] + dy[j - 1] * dy[j - 1]);
-                totalLength += ds;
-                arcLength[j] = totalLength;
-            }
-
-            // Normalize arc length
-            for (int j = 0; j < n; j++)
+        // Compute CSS at multiple scales using proper Gaussian convolution. Scales are independent
+        // and run as pool tasks; their zero crossings are appended in scale order afterwards.
+        std::vector<std::vector<std::pair<double, double>>> scaleCrossings(std::max(numScales, 0));
+        parallel::parallelFor(pool_.get(), 0, scaleCrossings.size(), 1, [&](size_t begin, size_t end)
+                              {
+            for (int i = static_cast<int>(begin); i < static_cast<int>(end); i++)
             {
-                arcLength[j] /= (totalLength + 1e-10);
-            }
+                CSS_TRACE_SCOPE_ARG("css.scale", "scale", i);
+                double sigma = (i + 1) * maxSigma / numScales;
 
-            // Compute curvature: κ = (X'Y'' - Y'X'') / (X'² + Y'²)^(3/2)
-            std::vector<double> curvature(n);
-            for (int j = 0; j < n; j++)
-            {
-                double numerator = dx[j] * d2y[j] - dy[j] * d2x[j];
-                double denominator = std::pow(dx[j] * dx[j] + dy[j] * dy[j], 1.5);
+                // Compute derivatives by convolving with Gaussian derivative kernels
+                std::vector<double> dx, dy, d2x, d2y;
+                computeDerivativesWithGaussian(contour, sigma, dx, dy, d2x, d2y);
 
-                if (denominator > 1e-10)
+                // Compute arc length (approximate) and curvature
+                int n = contour.size();
+                std::vector<double> arcLength(n);
+                std::vector<double> curvature(n);
                 {
-                    curvature[j] = numerator / denominator;
+                    CSS_PROFILE_SCOPE("css.curvature");
+                    arcLength[0] = 0.0;
+                    double totalLength = 0.0;
+
+                    for (int j = 1; j < n; j++)
+                    {
+                        double ds = std::sqrt(dx[j - 1] * dx[j - 1] + dy[j - 1] * dy[j - 1]);
+                        totalLength += ds;
+                        arcLength[j] = totalLength;
+                    }
+
+                    // Normalize arc length
+                    for (int j = 0; j < n; j++)
+                    {
+                        arcLength[j] /= (totalLength + 1e-10);
+                    }
+
+                    // Compute curvature: κ = (X'Y'' - Y'X'') / (X'² + Y'²)^(3/2)
+                    for (int j = 0; j < n; j++)
+                    {
+                        double numerator = dx[j] * d2y[j] - dy[j] * d2x[j];
+                        double denominator = std::pow(dx[j] * dx[j] + dy[j] * dy[j], 1.5);
+
+                        if (denominator > 1e-10)
+                        {
+                            curvature[j] = numerator / denominator;
+                        }
+                        else
+                        {
+                            curvature[j] = 0.0;
+                        }
+                    }
                 }
-                else
+
+                // Find zero crossings
+                auto crossings = findZeroCrossings(curvature);
+
+                // Store zero crossings with their arc length and scale
+                for (int idx : crossings)
                 {
-                    curvature[j] = 0.0;
+                    scaleCrossings[i].push_back({arcLength[idx], sigma});
                 }
-            }
-
-            // Find zero crossings
-            auto crossings = findZeroCrossings(curvature);
+            } });
 
-            // Store zero crossings with their arc length and scale
-            for (int idx : crossings)
-            {
-                css.zeroCrossings.push_back({arcLength[idx], sigma});
-            }
+        for (const auto &crossings : scaleCrossings)
+        {
+            css.zeroCrossings.insert(css.zeroCrossings.end(), crossings.begin(), crossings.end());
         }
 
-        // Create visual representation
-        css.image = visualizeCSSImage(css);
-
         return css;
     }
 
@@ -660,14 +858,14 @@ namespace css
 
         if (result == 0)
         {
-            std::cout << "GIF saved to: " << filename << std::endl;
-            std::cout << "Individual frames saved to: " << framesDir << std::endl;
+            CSS_LOG_INFO("GIF saved to: " << filename);
+            CSS_LOG_INFO("Individual frames saved to: " << framesDir);
             return true;
         }
         else
         {
-            std::cerr << "Error creating GIF. Make sure ImageMagick is installed." << std::endl;
-            std::cout << "Individual frames saved to: " << framesDir << std::endl;
+            CSS_LOG_ERROR("Cannot create GIF. Make sure ImageMagick is installed.");
+            CSS_LOG_INFO("Individual frames saved to: " << framesDir);
             return false;
         }
     }
@@ -732,21 +930,85 @@ namespace css
 
     std::vector<cv::Point> resampleContour(const std::vector<cv::Point> &contour, int numPoints)
     {
-        if (contour.size() <= numPoints)
+        // Samples closer than a pixel can round to the same point; keep one of each run
+        std::vector<cv::Point> resampled;
+        for (const auto &pt : resampleContourArcLength(contour, numPoints))
         {
-            return contour;
+            cv::Point rounded(cvRound(pt.x), cvRound(pt.y));
+            if (resampled.empty() || resampled.back() != rounded)
+            {
+                resampled.push_back(rounded);
+            }
         }
 
-        std::vector<cv::Point> resampled;
-        double step = static_cast<double>(contour.size()) / numPoints;
+        // The contour is closed, so the last point must not repeat the first either
+        if (resampled.size() > 1 && resampled.back() == resampled.front())
+        {
+            resampled.pop_back();
+        }
+        return resampled;
+    }
 
-        for (int i = 0; i < numPoints; i++)
+    namespace
+    {
+        template <typename PointT>
+        std::vector<cv::Point2d> resampleClosedCurve(const std::vector<PointT> &contour, int numPoints)
         {
-            int idx = static_cast<int>(i * step);
-            resampled.push_back(contour[idx]);
+            std::vector<cv::Point2d> resampled;
+            const size_t n = contour.size();
+            if (n == 0 || numPoints <= 0)
+            {
+                return resampled;
+            }
+            resampled.reserve(numPoints);
+
+            // Cumulative arc length, including the closing segment back to the first point
+            std::vector<double> cumulative(n + 1);
+            cumulative[0] = 0.0;
+            for (size_t i = 0; i < n; i++)
+            {
+                const PointT &a = contour[i];
+                const PointT &b = contour[(i + 1) % n];
+                cumulative[i + 1] = cumulative[i] + std::hypot(b.x - a.x, b.y - a.y);
+            }
+
+            const double totalLength = cumulative[n];
+            if (totalLength <= 0.0)
+            {
+                resampled.assign(numPoints, cv::Point2d(contour[0].x, contour[0].y));
+                return resampled;
+            }
+
+            // Walk the polygon once; target positions are increasing
+            const double step = totalLength / numPoints;
+            size_t seg = 0;
+            for (int k = 0; k < numPoints; k++)
+            {
+                const double s = k * step;
+                while (seg + 1 < n && cumulative[seg + 1] <= s)
+                {
+                    seg++;
+                }
+
+                const PointT &a = contour[seg];
+                const PointT &b = contour[(seg + 1) % n];
+                const double segLength = cumulative[seg + 1] - cumulative[seg];
+                const double t = segLength > 0.0 ? (s - cumulative[seg]) / segLength : 0.0;
+                resampled.push_back(cv::Point2d(a.x + t * (b.x - a.x), a.y + t * (b.y - a.y)));
+            }
+
+            return resampled;
         }
+    }
 
-        return resampled;
+    std::vector<cv::Point2d> resampleContourArcLength(const std::vector<cv::Point> &contour, int numPoints)
+    {
+        return resampleClosedCurve(contour, numPoints);
+    }
+
+    std::vector<cv::Point2d> resampleContourArcLength(const std::vector<cv::Point2d> &contour, int numPoints)
+    {
+        return resampleClosedCurve(contour, numPoints);
     }
 
 } // namespace css
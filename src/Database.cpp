@@ -0,0 +1,550 @@
+#include "Database.h"
+#include "Logging.h"
+#include "Tracing.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+namespace fs = std::filesystem;
+
+namespace recognition
+{
+
+    namespace
+    {
+        const char kMagic[8] = {'C', 'S', 'S', 'D', 'B', 'H', 'D', 'R'};
+        const char kManifestTag[] = "CSS_SHARD_MANIFEST";
+
+        template <typename T>
+        void writePod(std::ostream &os, const T &value)
+        {
+            os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        template <typename T>
+        bool readPod(std::istream &is, T &value)
+        {
+            is.read(reinterpret_cast<char *>(&value), sizeof(value));
+            return static_cast<bool>(is);
+        }
+
+        // Reads a count of elements of elementSize bytes stored next in the stream and takes their
+        // bytes from left, the bytes the stream has left. Fails when they would not fit, so a
+        // corrupt count is never used to allocate.
+        bool readCount(std::istream &is, uint64_t &left, size_t elementSize, size_t &count)
+        {
+            if (left < sizeof(count) || !readPod(is, count))
+            {
+                return false;
+            }
+            left -= sizeof(count);
+            if (count > left / elementSize)
+            {
+                return false;
+            }
+            left -= count * elementSize;
+            return true;
+        }
+
+        // Smallest shape entry: the name, contour and zero-crossing sizes (plus the curve size)
+        size_t minShapeEntryBytes(const DatabaseHeader &header)
+        {
+            return (!header.legacy && header.version >= 6 ? 4 : 3) * sizeof(size_t);
+        }
+
+        // Headerless files were built before resampling and library-side downscaling existed
+        DatabaseParams legacyParams(const DatabaseParams &defaultParams)
+        {
+            DatabaseParams params = defaultParams;
+            params.resamplePoints = 0;
+            params.contour.maxDimension = 0;
+            params.contour.source = css::ContourSource::Threshold;
+            return params;
+        }
+
+        // 64-bit FNV-1a
+        struct Fnv1a
+        {
+            uint64_t hash = 14695981039346656037ULL;
+
+            template <typename T>
+            void add(const T &value)
+            {
+                const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&value);
+                for (size_t i = 0; i < sizeof(T); i++)
+                {
+                    hash ^= bytes[i];
+                    hash *= 1099511628211ULL;
+                }
+            }
+        };
+    }
+
+    // ============================================================================
+    // Parameters
+    // ============================================================================
+
+    uint64_t DatabaseParams::fingerprint() const
+    {
+        Fnv1a h;
+        h.add(maxSigma);
+        h.add(static_cast<int32_t>(numScales));
+        h.add(static_cast<int32_t>(contour.blurKernelSize));
+        h.add(static_cast<int32_t>(contour.adaptiveBlockSize));
+        h.add(contour.adaptiveC);
+        h.add(static_cast<int32_t>(contour.morphKernelSize));
+        h.add(contour.cannyLow);
+        h.add(contour.cannyHigh);
+        if (contour.maxDimension != 0)
+        {
+            h.add(static_cast<int32_t>(contour.maxDimension));
+        }
+        if (resamplePoints != 0)
+        {
+            h.add(static_cast<int32_t>(resamplePoints) ^ 0x52534d50); // tagged, distinct from maxDimension
+        }
+        if (contour.source != css::ContourSource::Threshold)
+        {
+            h.add(static_cast<int32_t>(contour.source) ^ 0x53524345);
+        }
+        return h.hash;
+    }
+
+    // ============================================================================
+    // Header
+    // ============================================================================
+
+    void writeDatabaseHeader(std::ostream &os, const DatabaseParams &params, size_t numShapes)
+    {
+        os.write(kMagic, sizeof(kMagic));
+        writePod(os, kDatabaseVersion);
+
+        writePod(os, params.maxSigma);
+        writePod(os, static_cast<int32_t>(params.numScales));
+        writePod(os, static_cast<int32_t>(params.contour.blurKernelSize));
+        writePod(os, static_cast<int32_t>(params.contour.adaptiveBlockSize));
+        writePod(os, params.contour.adaptiveC);
+        writePod(os, static_cast<int32_t>(params.contour.morphKernelSize));
+        writePod(os, params.contour.cannyLow);
+        writePod(os, params.contour.cannyHigh);
+        writePod(os, static_cast<int32_t>(params.contour.maxDimension));
+        writePod(os, static_cast<int32_t>(params.resamplePoints));
+        writePod(os, static_cast<int32_t>(params.contour.source));
+
+        writePod(os, params.fingerprint());
+        writePod(os, numShapes);
+    }
+
+    static bool readHeaderFields(std::istream &is, DatabaseHeader &header)
+    {
+        char magic[sizeof(kMagic)];
+        if (!is.read(magic, sizeof(magic)))
+        {
+            return false;
+        }
+
+        // Legacy files start directly with the shape count
+        if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+        {
+            static_assert(sizeof(magic) == sizeof(size_t), "legacy shape count is a size_t");
+            header = DatabaseHeader();
+            header.legacy = true;
+            std::memcpy(&header.numShapes, magic, sizeof(header.numShapes));
+            return true;
+        }
+
+        header.legacy = false;
+        if (!readPod(is, header.version))
+        {
+            return false;
+        }
+        if (header.version < kOldestDatabaseVersion || header.version > kDatabaseVersion)
+        {
+            CSS_LOG_ERROR("Unsupported database version " << header.version);
+            return false;
+        }
+
+        int32_t numScales, blurKernelSize, adaptiveBlockSize, morphKernelSize;
+        int32_t maxDimension = 0;   // not stored before version 3
+        int32_t resamplePoints = 0; // not stored before version 4
+        int32_t source = 0;         // not stored before version 5 (threshold)
+        DatabaseParams &p = header.params;
+        bool ok = readPod(is, p.maxSigma) &&
+                  readPod(is, numScales) &&
+                  readPod(is, blurKernelSize) &&
+                  readPod(is, adaptiveBlockSize) &&
+                  readPod(is, p.contour.adaptiveC) &&
+                  readPod(is, morphKernelSize) &&
+                  readPod(is, p.contour.cannyLow) &&
+                  readPod(is, p.contour.cannyHigh) &&
+                  (header.version < 3 || readPod(is, maxDimension)) &&
+                  (header.version < 4 || readPod(is, resamplePoints)) &&
+                  (header.version < 5 || readPod(is, source)) &&
+                  readPod(is, header.fingerprint) &&
+                  readPod(is, header.numShapes);
+        if (!ok)
+        {
+            return false;
+        }
+        p.numScales = numScales;
+        p.contour.blurKernelSize = blurKernelSize;
+        p.contour.adaptiveBlockSize = adaptiveBlockSize;
+        p.contour.morphKernelSize = morphKernelSize;
+        p.contour.maxDimension = maxDimension;
+        p.resamplePoints = resamplePoints;
+        p.contour.source = static_cast<css::ContourSource>(source);
+
+        if (source != static_cast<int32_t>(css::ContourSource::Threshold) &&
+            source != static_cast<int32_t>(css::ContourSource::TOED))
+        {
+            CSS_LOG_ERROR("Unknown contour source " << source << " in database header");
+            return false;
+        }
+
+        if (header.fingerprint != p.fingerprint())
+        {
+            CSS_LOG_ERROR("Database header fingerprint mismatch (corrupt file?)");
+            return false;
+        }
+
+        return true;
+    }
+
+    bool readDatabaseHeader(std::istream &is, DatabaseHeader &header)
+    {
+        if (!readHeaderFields(is, header))
+        {
+            return false;
+        }
+
+        // Files without the magic are taken as legacy databases, so any other file lands here
+        // with a garbage shape count; the bytes left must be able to hold that many entries
+        header.streamEnd = -1;
+        const std::streamoff position = is.tellg();
+        if (position < 0 || !is.seekg(0, std::ios::end))
+        {
+            is.clear();
+            return true; // not seekable: entries are still checked as they are read
+        }
+        const std::streamoff end = is.tellg();
+        is.seekg(position);
+        if (end < position || !is)
+        {
+            return false;
+        }
+        header.streamEnd = end;
+
+        if (header.numShapes > static_cast<uint64_t>(end - position) / minShapeEntryBytes(header))
+        {
+            CSS_LOG_ERROR("Database header claims " << header.numShapes << " shapes, more than the file holds");
+            return false;
+        }
+        return true;
+    }
+
+    // ============================================================================
+    // Shape Entries
+    // ============================================================================
+
+    void writeShapeEntry(std::ostream &os, const ShapeEntry &shape)
+    {
+        // Write name length and name
+        size_t nameLen = shape.name.size();
+        writePod(os, nameLen);
+        os.write(shape.name.c_str(), nameLen);
+
+        // Write contour size and points
+        size_t contourSize = shape.contour.size();
+        writePod(os, contourSize);
+        for (const auto &pt : shape.contour)
+        {
+            writePod(os, pt.x);
+            writePod(os, pt.y);
+        }
+
+        // Write CSS zero crossings
+        size_t zcSize = shape.cssImage.zeroCrossings.size();
+        writePod(os, zcSize);
+        for (const auto &zc : shape.cssImage.zeroCrossings)
+        {
+            writePod(os, zc.first);
+            writePod(os, zc.second);
+        }
+
+        // Write subpixel curve (empty for threshold contours)
+        size_t curveSize = shape.curve.size();
+        writePod(os, curveSize);
+        for (const auto &pt : shape.curve)
+        {
+            writePod(os, pt.x);
+            writePod(os, pt.y);
+        }
+    }
+
+    bool readShapeEntry(std::istream &is, ShapeEntry &shape, const DatabaseHeader &header)
+    {
+        // Bytes left in the stream; one position query per entry keeps chunked reads cheap
+        uint64_t left = std::numeric_limits<uint64_t>::max();
+        if (header.streamEnd >= 0)
+        {
+            const std::streamoff position = is.tellg();
+            if (position < 0 || position > header.streamEnd)
+            {
+                return false;
+            }
+            left = static_cast<uint64_t>(header.streamEnd - position);
+        }
+
+        // Read name
+        size_t nameLen;
+        if (!readCount(is, left, 1, nameLen))
+        {
+            return false;
+        }
+        shape.name.resize(nameLen);
+        is.read(&shape.name[0], nameLen);
+
+        // Read contour
+        size_t contourSize;
+        if (!readCount(is, left, 2 * sizeof(int), contourSize))
+        {
+            return false;
+        }
+        shape.contour.resize(contourSize);
+        for (auto &pt : shape.contour)
+        {
+            readPod(is, pt.x);
+            readPod(is, pt.y);
+        }
+
+        // Read CSS zero crossings
+        size_t zcSize;
+        if (!readCount(is, left, 2 * sizeof(double), zcSize))
+        {
+            return false;
+        }
+        shape.cssImage.zeroCrossings.resize(zcSize);
+        for (auto &zc : shape.cssImage.zeroCrossings)
+        {
+            readPod(is, zc.first);
+            readPod(is, zc.second);
+        }
+
+        // Read subpixel curve
+        size_t curveSize = 0;
+        if (!header.legacy && header.version >= 6 && !readCount(is, left, 2 * sizeof(double), curveSize))
+        {
+            return false;
+        }
+        shape.curve.resize(curveSize);
+        for (auto &pt : shape.curve)
+        {
+            readPod(is, pt.x);
+            readPod(is, pt.y);
+        }
+
+        shape.cssImage.maxSigma = header.params.maxSigma;
+        shape.cssImage.numScales = header.params.numScales;
+
+        return static_cast<bool>(is);
+    }
+
+    // ============================================================================
+    // Database Files
+    // ============================================================================
+
+    bool writeDatabaseFile(const std::string &filepath, const DatabaseParams &params,
+                           const ShapeEntry *shapes, size_t numShapes)
+    {
+        CSS_TRACE_SCOPE_ARG("database.write", "shapes", numShapes);
+        std::ofstream ofs(filepath, std::ios::binary);
+        if (!ofs)
+        {
+            CSS_LOG_ERROR("Cannot open file for writing: " << filepath);
+            return false;
+        }
+
+        writeDatabaseHeader(ofs, params, numShapes);
+        for (size_t i = 0; i < numShapes; i++)
+        {
+            writeShapeEntry(ofs, shapes[i]);
+        }
+
+        return static_cast<bool>(ofs);
+    }
+
+    bool readDatabaseFile(const std::string &filepath, const DatabaseParams &defaultParams,
+                          DatabaseHeader &header, std::vector<ShapeEntry> &shapes)
+    {
+        CSS_TRACE_SCOPE("database.read");
+        std::ifstream ifs(filepath, std::ios::binary);
+        if (!ifs)
+        {
+            CSS_LOG_ERROR("Cannot open file for reading: " << filepath);
+            return false;
+        }
+
+        if (!readDatabaseHeader(ifs, header))
+        {
+            CSS_LOG_ERROR("Invalid database header: " << filepath);
+            return false;
+        }
+
+        if (header.legacy)
+        {
+            header.params = legacyParams(defaultParams);
+        }
+
+        shapes.clear();
+        for (size_t i = 0; i < header.numShapes; i++)
+        {
+            ShapeEntry shape;
+            if (!readShapeEntry(ifs, shape, header))
+            {
+                CSS_LOG_ERROR("Truncated database file: " << filepath);
+                shapes.clear();
+                return false;
+            }
+            shapes.push_back(std::move(shape));
+        }
+
+        return true;
+    }
+
+    // ============================================================================
+    // Streaming Reader
+    // ============================================================================
+
+    bool DatabaseReader::open(const std::string &filepath, const DatabaseParams &defaultParams)
+    {
+        // Large stream buffer so sequential chunk reads run close to disk bandwidth
+        buffer_.resize(1 << 20);
+        ifs_.rdbuf()->pubsetbuf(buffer_.data(), buffer_.size());
+
+        ifs_.open(filepath, std::ios::binary);
+        if (!ifs_)
+        {
+            CSS_LOG_ERROR("Cannot open file for reading: " << filepath);
+            return false;
+        }
+
+        if (!readDatabaseHeader(ifs_, header_))
+        {
+            CSS_LOG_ERROR("Invalid database header: " << filepath);
+            return false;
+        }
+
+        if (header_.legacy)
+        {
+            header_.params = legacyParams(defaultParams);
+        }
+
+        numRead_ = 0;
+        failed_ = false;
+        return true;
+    }
+
+    size_t DatabaseReader::readChunk(std::vector<ShapeEntry> &chunk, size_t maxShapes)
+    {
+        CSS_TRACE_SCOPE_ARG("database.read_chunk", "max_shapes", maxShapes);
+        const size_t count = std::min(maxShapes, remaining());
+        if (failed_ || count == 0)
+        {
+            chunk.clear();
+            return 0;
+        }
+
+        chunk.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!readShapeEntry(ifs_, chunk[i], header_))
+            {
+                CSS_LOG_ERROR("Truncated database file while streaming");
+                failed_ = true;
+                chunk.resize(i);
+                break;
+            }
+        }
+
+        numRead_ += chunk.size();
+        return chunk.size();
+    }
+
+    // ============================================================================
+    // Shard Manifest
+    // ============================================================================
+
+    bool writeShardManifest(const std::string &manifestPath, const ShardManifest &manifest)
+    {
+        std::ofstream ofs(manifestPath);
+        if (!ofs)
+        {
+            CSS_LOG_ERROR("Cannot open file for writing: " << manifestPath);
+            return false;
+        }
+
+        ofs << kManifestTag << " " << kDatabaseVersion << "\n";
+        ofs << std::hex << std::setw(16) << std::setfill('0') << manifest.fingerprint << std::dec << "\n";
+        ofs << manifest.shardPaths.size() << "\n";
+        for (const auto &path : manifest.shardPaths)
+        {
+            ofs << path << "\n";
+        }
+
+        return static_cast<bool>(ofs);
+    }
+
+    bool readShardManifest(const std::string &manifestPath, ShardManifest &manifest)
+    {
+        CSS_TRACE_SCOPE("database.read_manifest");
+        std::ifstream ifs(manifestPath);
+        if (!ifs)
+        {
+            CSS_LOG_ERROR("Cannot open file for reading: " << manifestPath);
+            return false;
+        }
+
+        std::string tag;
+        uint32_t version = 0;
+        size_t numShards = 0;
+        ifs >> tag >> version >> std::hex >> manifest.fingerprint >> std::dec >> numShards;
+        if (!ifs || tag != kManifestTag ||
+            version < kOldestDatabaseVersion || version > kDatabaseVersion)
+        {
+            CSS_LOG_ERROR("Invalid shard manifest: " << manifestPath);
+            return false;
+        }
+
+        const fs::path baseDir = fs::path(manifestPath).parent_path();
+        manifest.shardPaths.clear();
+
+        std::string line;
+        std::getline(ifs, line); // rest of the count line
+        while (manifest.shardPaths.size() < numShards && std::getline(ifs, line))
+        {
+            if (line.empty())
+            {
+                continue;
+            }
+            fs::path shardPath(line);
+            if (shardPath.is_relative())
+            {
+                shardPath = baseDir / shardPath;
+            }
+            manifest.shardPaths.push_back(shardPath.string());
+        }
+
+        if (manifest.shardPaths.size() != numShards)
+        {
+            CSS_LOG_ERROR("Shard manifest lists " << manifest.shardPaths.size()
+                          << " of " << numShards << " shards: " << manifestPath);
+            return false;
+        }
+
+        return true;
+    }
+
+} // namespace recognition
@@ -0,0 +1,146 @@
+#include "ExecutionContext.h"
+#include "Logging.h"
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace parallel
+{
+
+    size_t ExecutionContext::resolvedThreads() const
+    {
+        if (numThreads > 0)
+        {
+            return numThreads;
+        }
+        if (!cpus.empty())
+        {
+            return cpus.size();
+        }
+        return std::max<size_t>(1, availableCpus().size());
+    }
+
+    bool ExecutionContext::pin(size_t index) const
+    {
+        return cpus.empty() || pinCurrentThread(cpus, index);
+    }
+
+    ExecutionContext ExecutionContext::partition(size_t index, size_t count)
+    {
+        const std::vector<int> available = availableCpus();
+        count = std::max<size_t>(count, 1);
+        index %= count;
+
+        // Slice boundaries are rounded so sizes differ by at most one
+        ExecutionContext context;
+        if (count <= available.size())
+        {
+            const size_t begin = index * available.size() / count;
+            const size_t end = (index + 1) * available.size() / count;
+            context.cpus.assign(available.begin() + begin, available.begin() + end);
+        }
+        else
+        {
+            context.cpus.push_back(available[index % available.size()]);
+        }
+        context.numThreads = context.cpus.size();
+        return context;
+    }
+
+    std::vector<int> availableCpus()
+    {
+        std::vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            {
+                if (CPU_ISSET(cpu, &set))
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+#endif
+        if (cpus.empty())
+        {
+            const int n = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+            for (int cpu = 0; cpu < n; cpu++)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    bool parseCpuList(const std::string &list, std::vector<int> &cpus)
+    {
+        std::vector<int> parsed;
+        std::stringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ','))
+        {
+            int first = 0, last = 0;
+            char dash = 0, extra = 0;
+            std::stringstream part(range);
+            if (!(part >> first) || first < 0)
+            {
+                CSS_LOG_ERROR("Invalid CPU list: " << list);
+                return false;
+            }
+            last = first;
+            if (part >> dash && (dash != '-' || !(part >> last) || last < first))
+            {
+                CSS_LOG_ERROR("Invalid CPU range '" << range << "' in " << list);
+                return false;
+            }
+            if (part >> extra)
+            {
+                CSS_LOG_ERROR("Invalid CPU range '" << range << "' in " << list);
+                return false;
+            }
+            for (int cpu = first; cpu <= last; cpu++)
+            {
+                parsed.push_back(cpu);
+            }
+        }
+        if (parsed.empty())
+        {
+            CSS_LOG_ERROR("Empty CPU list");
+            return false;
+        }
+        cpus = std::move(parsed);
+        return true;
+    }
+
+    bool pinCurrentThread(const std::vector<int> &cpus, size_t index)
+    {
+        if (cpus.empty())
+        {
+            return false;
+        }
+        const int cpu = cpus[index % cpus.size()];
+#ifdef __linux__
+        if (cpu < CPU_SETSIZE)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+            {
+                return true;
+            }
+        }
+#endif
+        CSS_LOG_WARNING("Cannot pin thread to CPU " << cpu);
+        return false;
+    }
+
+} // namespace parallel
@@ -0,0 +1,105 @@
+#include "Logging.h"
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+namespace logging
+{
+
+    namespace
+    {
+        std::atomic<int> g_level{static_cast<int>(Level::Info)};
+        std::mutex g_writeMutex;
+
+        // Counters are never removed, so references handed out stay valid
+        std::mutex g_counterMutex;
+        std::map<std::string, std::unique_ptr<Counter>> &counterRegistry()
+        {
+            static std::map<std::string, std::unique_ptr<Counter>> registry;
+            return registry;
+        }
+    }
+
+    void setLevel(Level level)
+    {
+        g_level.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    Level getLevel()
+    {
+        return static_cast<Level>(g_level.load(std::memory_order_relaxed));
+    }
+
+    void write(Level level, const std::string &message)
+    {
+        const char *prefix = "";
+        FILE *stream = stdout;
+        switch (level)
+        {
+        case Level::Debug:
+            prefix = "Debug: ";
+            break;
+        case Level::Warning:
+            prefix = "Warning: ";
+            stream = stderr;
+            break;
+        case Level::Error:
+            prefix = "Error: ";
+            stream = stderr;
+            break;
+        default:
+            break;
+        }
+
+        std::string line = prefix + message + "\n";
+
+        std::lock_guard<std::mutex> lock(g_writeMutex);
+        std::fwrite(line.data(), 1, line.size(), stream);
+        if (stream == stderr)
+        {
+            std::fflush(stream);
+        }
+    }
+
+    Counter &counter(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(g_counterMutex);
+        auto &slot = counterRegistry()[name];
+        if (!slot)
+        {
+            slot = std::make_unique<Counter>();
+        }
+        return *slot;
+    }
+
+    std::map<std::string, uint64_t> counters()
+    {
+        std::lock_guard<std::mutex> lock(g_counterMutex);
+        std::map<std::string, uint64_t> values;
+        for (const auto &entry : counterRegistry())
+        {
+            values[entry.first] = entry.second->value();
+        }
+        return values;
+    }
+
+    void resetCounters()
+    {
+        std::lock_guard<std::mutex> lock(g_counterMutex);
+        for (auto &entry : counterRegistry())
+        {
+            entry.second->reset();
+        }
+    }
+
+    std::string formatCounters()
+    {
+        std::ostringstream os;
+        for (const auto &entry : counters())
+        {
+            os << entry.first << ": " << entry.second << "\n";
+        }
+        return os.str();
+    }
+
+} // namespace logging
@@ -0,0 +1,236 @@
+#include "Profiling.h"
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace profiling
+{
+
+    namespace
+    {
+        struct ThreadTable;
+
+        // Site names and kinds, live thread tables and the totals of exited threads. Lock order:
+        // registry mutex before any thread table mutex.
+        struct Registry
+        {
+            std::mutex mutex;
+            std::map<std::string, int> ids;
+            std::vector<std::string> names;
+            std::vector<Kind> kinds;
+            std::vector<ThreadTable *> threads;
+            std::vector<Stat> retired;
+        };
+
+        Registry &registry()
+        {
+            static Registry instance;
+            return instance;
+        }
+
+        void mergeInto(std::vector<Stat> &target, const std::vector<Stat> &source)
+        {
+            if (target.size() < source.size())
+            {
+                target.resize(source.size());
+            }
+            for (size_t i = 0; i < source.size(); i++)
+            {
+                target[i].merge(source[i]);
+            }
+        }
+
+        // Written by its own thread; the mutex is only contended while a snapshot is taken
+        struct ThreadTable
+        {
+            std::mutex mutex;
+            std::vector<Stat> stats;
+
+            ThreadTable()
+            {
+                Registry &reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                reg.threads.push_back(this);
+            }
+
+            ~ThreadTable()
+            {
+                Registry &reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                mergeInto(reg.retired, stats);
+                reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), this));
+            }
+
+            Stat &slot(int site)
+            {
+                if (static_cast<size_t>(site) >= stats.size())
+                {
+                    stats.resize(site + 1);
+                }
+                return stats[site];
+            }
+        };
+
+        ThreadTable &localTable()
+        {
+            thread_local ThreadTable table;
+            return table;
+        }
+    }
+
+    void Stat::merge(const Stat &other)
+    {
+        if (other.calls == 0)
+        {
+            return;
+        }
+        if (calls == 0)
+        {
+            minMs = other.minMs;
+            maxMs = other.maxMs;
+        }
+        else
+        {
+            minMs = std::min(minMs, other.minMs);
+            maxMs = std::max(maxMs, other.maxMs);
+        }
+        calls += other.calls;
+        totalMs += other.totalMs;
+    }
+
+    int site(const std::string &name, Kind kind)
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        auto it = reg.ids.find(name);
+        if (it != reg.ids.end())
+        {
+            return it->second;
+        }
+        const int id = static_cast<int>(reg.names.size());
+        reg.ids[name] = id;
+        reg.names.push_back(name);
+        reg.kinds.push_back(kind);
+        return id;
+    }
+
+    void record(int site, double ms)
+    {
+        ThreadTable &table = localTable();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        Stat sample;
+        sample.calls = 1;
+        sample.totalMs = sample.minMs = sample.maxMs = ms;
+        table.slot(site).merge(sample);
+    }
+
+    void count(int site, uint64_t delta)
+    {
+        ThreadTable &table = localTable();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        table.slot(site).calls += delta;
+    }
+
+    std::map<std::string, Stat> snapshot()
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        std::vector<Stat> merged = reg.retired;
+        for (ThreadTable *table : reg.threads)
+        {
+            std::lock_guard<std::mutex> tableLock(table->mutex);
+            mergeInto(merged, table->stats);
+        }
+
+        std::map<std::string, Stat> result;
+        for (size_t i = 0; i < merged.size(); i++)
+        {
+            if (merged[i].calls > 0)
+            {
+                merged[i].kind = reg.kinds[i];
+                result[reg.names[i]] = merged[i];
+            }
+        }
+        return result;
+    }
+
+    void reset()
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.retired.clear();
+        for (ThreadTable *table : reg.threads)
+        {
+            std::lock_guard<std::mutex> tableLock(table->mutex);
+            table->stats.clear();
+        }
+    }
+
+    std::string formatReport()
+    {
+        const std::map<std::string, Stat> stats = snapshot();
+        size_t width = 8;
+        for (const auto &entry : stats)
+        {
+            width = std::max(width, entry.first.size());
+        }
+
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(3);
+        os << std::left << std::setw(width) << "timer" << std::right << std::setw(10) << "calls"
+           << std::setw(13) << "total ms" << std::setw(11) << "mean ms" << std::setw(11) << "min ms"
+           << std::setw(11) << "max ms" << "\n";
+        for (const auto &entry : stats)
+        {
+            if (entry.second.kind != Kind::Timer)
+                continue;
+            const Stat &s = entry.second;
+            os << std::left << std::setw(width) << entry.first << std::right << std::setw(10) << s.calls
+               << std::setw(13) << s.totalMs << std::setw(11) << s.meanMs() << std::setw(11) << s.minMs
+               << std::setw(11) << s.maxMs << "\n";
+        }
+        bool counterHeader = false;
+        for (const auto &entry : stats)
+        {
+            if (entry.second.kind != Kind::Counter)
+                continue;
+            if (!counterHeader)
+            {
+                os << "\n" << std::left << std::setw(width) << "counter" << std::right << std::setw(10) << "count" << "\n";
+                counterHeader = true;
+            }
+            os << std::left << std::setw(width) << entry.first << std::right << std::setw(10) << entry.second.calls << "\n";
+        }
+        return os.str();
+    }
+
+    std::string formatJson()
+    {
+        const std::map<std::string, Stat> stats = snapshot();
+        std::ostringstream timers, counters;
+        for (const auto &entry : stats)
+        {
+            // Site names are identifiers chosen in the code, no escaping needed
+            const Stat &s = entry.second;
+            if (s.kind == Kind::Timer)
+            {
+                timers << (timers.tellp() > 0 ? ",\n" : "\n") << "    \"" << entry.first << "\": {\"calls\": " << s.calls
+                       << ", \"total_ms\": " << s.totalMs << ", \"mean_ms\": " << s.meanMs()
+                       << ", \"min_ms\": " << s.minMs << ", \"max_ms\": " << s.maxMs << "}";
+            }
+            else
+            {
+                counters << (counters.tellp() > 0 ? ",\n" : "\n") << "    \"" << entry.first << "\": " << s.calls;
+            }
+        }
+
+        std::ostringstream os;
+        os << "{\n  \"timers\": {" << timers.str() << (timers.tellp() > 0 ? "\n  " : "") << "},\n"
+           << "  \"counters\": {" << counters.str() << (counters.tellp() > 0 ? "\n  " : "") << "}\n}\n";
+        return os.str();
+    }
+
+} // namespace profiling
@@ -1,20 +1,26 @@
 #include "Recognition.h"
+#include "Logging.h"
+#include "Profiling.h"
+#include "Tracing.h"
 #include <filesystem>
 #include <fstream>
 #include <algorithm>
 #include <iostream>
 #include <cmath>
-
-#ifdef _OPENMP
-#include <omp.h>
-#endif
+#include <future>
 
 namespace fs = std::filesystem;
 
 namespace recognition
 {
 
-    Recognition::Recognition() : maxSigma_(4.0), numScales_(20) {}
+    Recognition::Recognition(const parallel::ExecutionContext &context)
+        : context_(context), pool_(std::make_shared<parallel::ThreadPool>(context)), databaseGeneration_(0),
+          maxSigma_(4.0), numScales_(20), resamplePoints_(256), databaseFingerprint_(0), mismatchPolicy_(MismatchPolicy::Reject)
+    {
+        cssComputer_.setThreadPool(pool_);
+        updateParamsFingerprint();
+    }
 
     Recognition::~Recognition() {}
 
@@ -22,11 +28,299 @@ namespace recognition
     {
         maxSigma_ = maxSigma;
         numScales_ = numScales;
+        updateParamsFingerprint();
+    }
+
+    void Recognition::setResamplePoints(int numPoints)
+    {
+        resamplePoints_ = std::max(0, numPoints);
+        updateParamsFingerprint();
+    }
+
+    void Recognition::setContourSource(css::ContourSource source)
+    {
+        css::ContourParams params = cssComputer_.getContourParams();
+        params.source = source;
+        setContourParams(params);
     }
 
     void Recognition::setEdgeDetectionParams(double lowThresh, double highThresh)
     {
         cssComputer_.setEdgeDetectionParams(lowThresh, highThresh);
+        updateParamsFingerprint();
+    }
+
+    void Recognition::setContourParams(const css::ContourParams &params)
+    {
+        cssComputer_.setContourParams(params);
+        updateParamsFingerprint();
+    }
+
+    DatabaseParams Recognition::getParameters() const
+    {
+        DatabaseParams params;
+        params.maxSigma = maxSigma_;
+        params.numScales = numScales_;
+        params.resamplePoints = resamplePoints_;
+        params.contour = cssComputer_.getContourParams();
+        return params;
+    }
+
+    void Recognition::updateParamsFingerprint()
+    {
+        paramsFingerprint_ = getParameters().fingerprint();
+    }
+
+    void Recognition::adoptParameters(const DatabaseParams &params)
+    {
+        maxSigma_ = params.maxSigma;
+        numScales_ = params.numScales;
+        resamplePoints_ = params.resamplePoints;
+        cssComputer_.setContourParams(params.contour);
+        updateParamsFingerprint();
+    }
+
+    bool Recognition::checkStreamingParameters(const DatabaseParams &params) const
+    {
+        if (params.fingerprint() == paramsFingerprint_)
+        {
+            return true;
+        }
+
+        CSS_LOG_ERROR("Recognizer parameters (maxSigma=" << maxSigma_ << ", numScales=" << numScales_
+                      << ") do not match the on-disk database (maxSigma=" << params.maxSigma
+                      << ", numScales=" << params.numScales << "); call useDatabaseParameters first");
+        return false;
+    }
+
+    bool Recognition::useDatabaseParameters(const std::string &path)
+    {
+        // A manifest records the parameters of its shards in every shard header
+        std::string filepath = path;
+        ShardManifest manifest;
+        const bool sharded = fs::path(path).extension() == ".shards";
+        if (sharded)
+        {
+            if (!readShardManifest(path, manifest) || manifest.shardPaths.empty())
+            {
+                return false;
+            }
+            filepath = manifest.shardPaths.front();
+        }
+
+        DatabaseReader reader;
+        if (!reader.open(filepath, getParameters()) || (sharded && reader.header().fingerprint != manifest.fingerprint))
+        {
+            CSS_LOG_ERROR("Cannot read database parameters from " << path);
+            return false;
+        }
+        const DatabaseParams &params = reader.header().params;
+        if (params.fingerprint() == paramsFingerprint_)
+        {
+            return true;
+        }
+
+        // The in-memory database pins the current parameters
+        if (!database_.empty())
+        {
+            CSS_LOG_ERROR("Recognizer parameters do not match " << path << " and the loaded database");
+            return false;
+        }
+
+        adoptParameters(params);
+        return true;
+    }
+
+    css::CSSImage Recognition::computeDescriptor(const std::vector<cv::Point> &contour)
+    {
+        CSS_PROFILE_SCOPE("recognition.describe");
+        if (resamplePoints_ > 0)
+        {
+            // Fixed budget: CSS cost per shape no longer grows with image resolution
+            return cssComputer_.computeCSS(css::resampleContourArcLength(contour, resamplePoints_),
+                                           maxSigma_, numScales_);
+        }
+        return cssComputer_.computeCSS(contour, maxSigma_, numScales_);
+    }
+
+    css::CSSImage Recognition::computeDescriptor(const std::vector<cv::Point2d> &curve)
+    {
+        CSS_PROFILE_SCOPE("recognition.describe");
+        if (resamplePoints_ > 0)
+        {
+            return cssComputer_.computeCSS(css::resampleContourArcLength(curve, resamplePoints_),
+                                           maxSigma_, numScales_);
+        }
+        return cssComputer_.computeCSS(curve, maxSigma_, numScales_);
+    }
+
+    bool Recognition::usesSubpixelContours() const
+    {
+        return cssComputer_.getContourParams().source == css::ContourSource::TOED;
+    }
+
+    bool Recognition::describeImage(const cv::Mat &image, QueryShape &shape, css::CSSImage &descriptor)
+    {
+        if (!extractQuery(image, shape))
+        {
+            return false;
+        }
+        descriptor = describeQuery(shape);
+        return true;
+    }
+
+    bool Recognition::extractQuery(const cv::Mat &image, QueryShape &query)
+    {
+        query.curve.clear();
+        if (!usesSubpixelContours())
+        {
+            query.contour = cssComputer_.extractContour(image);
+            return !query.contour.empty();
+        }
+
+        // The descriptor keeps subpixel precision; the stored contour is the curve on the pixel grid
+        query.curve = cssComputer_.extractSubpixelContour(image);
+        query.contour = roundCurve(query.curve);
+        return !query.curve.empty();
+    }
+
+    css::CSSImage Recognition::describeQuery(const QueryShape &query)
+    {
+        return query.curve.empty() ? computeDescriptor(query.contour) : computeDescriptor(query.curve);
+    }
+
+    std::vector<ShapeEntry> Recognition::matchQuery(const css::CSSImage &queryCSS, int topK)
+    {
+        if (database_.empty())
+        {
+            CSS_LOG_ERROR("Database is empty!");
+            return std::vector<ShapeEntry>();
+        }
+
+        if (!ensureCompatibleDatabase())
+        {
+            return std::vector<ShapeEntry>();
+        }
+
+        return matchDescriptor(queryCSS, topK);
+    }
+
+    std::vector<ShapeEntry> Recognition::matchQuery(const css::CSSImage &queryCSS, int topK,
+                                                    const std::vector<ShapeEntry> &warmStart)
+    {
+        if (database_.empty())
+        {
+            CSS_LOG_ERROR("Database is empty!");
+            return std::vector<ShapeEntry>();
+        }
+
+        if (!ensureCompatibleDatabase())
+        {
+            return std::vector<ShapeEntry>();
+        }
+
+        // The k-th best distance to any k database shapes bounds the k-th best over the database
+        double bound = std::numeric_limits<double>::max();
+        if (topK > 0 && warmStart.size() >= static_cast<size_t>(topK))
+        {
+            TopK<size_t> seeds(topK);
+            for (size_t i = 0; i < warmStart.size(); i++)
+            {
+                seeds.push(computeShapeDistance(queryCSS, warmStart[i].cssImage), i);
+            }
+            bound = seeds.worstScore();
+            CSS_LOG_COUNT("recognition.warm_starts", 1);
+        }
+
+        return matchDescriptor(queryCSS, topK, bound);
+    }
+
+    std::vector<cv::Point> Recognition::roundCurve(const std::vector<cv::Point2d> &curve)
+    {
+        std::vector<cv::Point> contour;
+        contour.reserve(curve.size());
+        for (const auto &pt : curve)
+        {
+            cv::Point rounded(cvRound(pt.x), cvRound(pt.y));
+            if (contour.empty() || contour.back() != rounded)
+            {
+                contour.push_back(rounded);
+            }
+        }
+        return contour;
+    }
+
+    // ============================================================================
+    // Parameter Compatibility
+    // ============================================================================
+
+    bool Recognition::isDatabaseCompatible() const
+    {
+        return database_.empty() || paramsFingerprint_ == databaseFingerprint_;
+    }
+
+    bool Recognition::ensureCompatibleDatabase()
+    {
+        if (isDatabaseCompatible())
+        {
+            return true;
+        }
+
+        if (mismatchPolicy_ == MismatchPolicy::Reindex)
+        {
+            return reindexDatabase();
+        }
+
+        CSS_LOG_ERROR("Recognizer parameters (maxSigma=" << maxSigma_ << ", numScales=" << numScales_
+                      << ") do not match the database (maxSigma=" << databaseParams_.maxSigma
+                      << ", numScales=" << databaseParams_.numScales << ")");
+        return false;
+    }
+
+    bool Recognition::reindexDatabase()
+    {
+        if (database_.empty())
+        {
+            return true;
+        }
+
+        // Stored contours were extracted with the database settings; they cannot be re-extracted
+        if (cssComputer_.getContourParams() != databaseParams_.contour)
+        {
+            CSS_LOG_ERROR("Cannot reindex database, contour extraction settings differ "
+                          << "from the ones it was built with");
+            return false;
+        }
+
+        // TOED descriptors come from the subpixel curves; the rounded contours would not match queries
+        if (usesSubpixelContours())
+        {
+            for (const auto &shape : database_)
+            {
+                if (shape.curve.empty())
+                {
+                    CSS_LOG_ERROR("Cannot reindex database, TOED shapes were saved without their "
+                                  << "subpixel curves (database version < 6)");
+                    return false;
+                }
+            }
+        }
+
+        CSS_LOG_INFO("Reindexing " << database_.size() << " shapes with maxSigma=" << maxSigma_
+                     << ", numScales=" << numScales_);
+
+        pool_->parallelFor(0, database_.size(), 1, [this](size_t begin, size_t end)
+                           {
+            for (size_t i = begin; i < end; i++)
+            {
+                const ShapeEntry &shape = database_[i];
+                database_[i].cssImage = shape.curve.empty() ? computeDescriptor(shape.contour) : computeDescriptor(shape.curve);
+            } });
+
+        databaseParams_ = getParameters();
+        databaseFingerprint_ = paramsFingerprint_;
+        markDatabaseChanged();
+        return true;
     }
 
     // ============================================================================
@@ -37,173 +331,325 @@ namespace recognition
     {
         if (!fs::exists(databaseDir) || !fs::is_directory(databaseDir))
         {
-            std::cerr << "Error: Database directory does not exist: " << databaseDir << std::endl;
+            CSS_LOG_ERROR("Database directory does not exist: " << databaseDir);
             return false;
         }
 
-        int loadedCount = 0;
-
+        std::vector<fs::path> paths;
         for (const auto &entry : fs::directory_iterator(databaseDir))
         {
             if (entry.is_regular_file())
             {
-                std::string path = entry.path().string();
                 std::string ext = entry.path().extension().string();
 
                 // Check if it's an image file
                 if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" ||
                     ext == ".bmp" || ext == ".tif")
                 {
-
-                    cv::Mat img = cv::imread(path, cv::IMREAD_GRAYSCALE);
-                    if (!img.empty())
-                    {
-                        std::string name = entry.path().stem().string();
-                        addShape(name, img);
-                        loadedCount++;
-                        std::cout << "Loaded: " << name << std::endl;
-                    }
+                    paths.push_back(entry.path());
                 }
             }
         }
 
-        std::cout << "Database loaded: " << loadedCount << " shapes" << std::endl;
+        if (!ensureCompatibleDatabase())
+        {
+            return false;
+        }
+
+        // Images are read and described as pool tasks (each descriptor spreads its scales over idle
+        // workers), then added in directory order
+        struct LoadedImage
+        {
+            bool read = false;
+            bool described = false;
+            QueryShape shape;
+            css::CSSImage descriptor;
+        };
+        std::vector<LoadedImage> loaded(paths.size());
+        pool_->parallelFor(0, paths.size(), 1, [this, &paths, &loaded](size_t begin, size_t end)
+                           {
+            for (size_t i = begin; i < end; i++)
+            {
+                cv::Mat image = cv::imread(paths[i].string(), cv::IMREAD_GRAYSCALE);
+                loaded[i].read = !image.empty();
+                loaded[i].described = loaded[i].read && describeImage(image, loaded[i].shape, loaded[i].descriptor);
+            } });
+
+        int loadedCount = 0;
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            if (!loaded[i].read)
+            {
+                continue;
+            }
+
+            std::string name = paths[i].stem().string();
+            if (loaded[i].described)
+            {
+                addEntry(name, loaded[i].shape.contour, std::move(loaded[i].descriptor), loaded[i].shape.curve);
+            }
+            else
+            {
+                CSS_LOG_WARNING("Could not extract contour for " << name);
+            }
+            loadedCount++;
+            CSS_LOG_DEBUG("Loaded: " << name);
+            CSS_LOG_COUNT("recognition.shapes_loaded", 1);
+        }
+
+        CSS_LOG_INFO("Database loaded: " << loadedCount << " shapes");
         return loadedCount > 0;
     }
 
     void Recognition::addShape(const std::string &name, const cv::Mat &image)
     {
-        ShapeEntry entry;
-        entry.name = name;
-        entry.imagePath = "";
+        if (!ensureCompatibleDatabase())
+        {
+            return;
+        }
 
         // Extract contour
-        entry.contour = cssComputer_.extractContour(image);
+        QueryShape shape;
+        css::CSSImage descriptor;
+        if (!describeImage(image, shape, descriptor))
+        {
+            CSS_LOG_WARNING("Could not extract contour for " << name);
+            return;
+        }
+
+        addEntry(name, shape.contour, std::move(descriptor), shape.curve);
+    }
 
-        if (entry.contour.empty())
+    void Recognition::addShape(const std::string &name, const std::vector<cv::Point> &contour)
+    {
+        if (!ensureCompatibleDatabase())
         {
-            std::cerr << "Warning: Could not extract contour for " << name << std::endl;
             return;
         }
 
         // Compute CSS
-        entry.cssImage = cssComputer_.computeCSS(entry.contour, maxSigma_, numScales_);
+        addEntry(name, contour, computeDescriptor(contour));
+    }
 
-        database_.push_back(entry);
+    void Recognition::addShapes(const std::vector<std::string> &names,
+                                const std::vector<std::vector<cv::Point>> &contours)
+    {
+        if (names.size() != contours.size())
+        {
+            CSS_LOG_ERROR("addShapes: " << names.size() << " names for " << contours.size() << " contours");
+            return;
+        }
+        if (!ensureCompatibleDatabase())
+        {
+            return;
+        }
+
+        // Descriptors in parallel, then appended in input order
+        std::vector<css::CSSImage> descriptors(contours.size());
+        pool_->parallelFor(0, contours.size(), 1, [this, &contours, &descriptors](size_t begin, size_t end)
+                           {
+            for (size_t i = begin; i < end; i++)
+            {
+                descriptors[i] = computeDescriptor(contours[i]);
+            } });
+
+        database_.reserve(database_.size() + contours.size());
+        for (size_t i = 0; i < contours.size(); i++)
+        {
+            addEntry(names[i], contours[i], std::move(descriptors[i]));
+        }
     }
 
-    void Recognition::addShape(const std::string &name, const std::vector<cv::Point> &contour)
+    void Recognition::setNumThreads(size_t numThreads)
+    {
+        parallel::ExecutionContext context = context_;
+        context.numThreads = numThreads;
+        setExecutionContext(context);
+    }
+
+    void Recognition::setExecutionContext(const parallel::ExecutionContext &context)
+    {
+        context_ = context;
+        pool_ = std::make_shared<parallel::ThreadPool>(context_);
+        cssComputer_.setThreadPool(pool_);
+    }
+
+    void Recognition::addEntry(const std::string &name, const std::vector<cv::Point> &contour,
+                               css::CSSImage descriptor, const std::vector<cv::Point2d> &curve)
     {
         ShapeEntry entry;
         entry.name = name;
         entry.imagePath = "";
         entry.contour = contour;
+        entry.curve = curve;
+        entry.cssImage = std::move(descriptor);
 
-        // Compute CSS
-        entry.cssImage = cssComputer_.computeCSS(contour, maxSigma_, numScales_);
+        // The first shape fixes the parameters of the database
+        if (database_.empty())
+        {
+            databaseParams_ = getParameters();
+            databaseFingerprint_ = paramsFingerprint_;
+        }
 
         database_.push_back(entry);
+        markDatabaseChanged();
     }
 
     void Recognition::clearDatabase()
     {
         database_.clear();
+        shardOffsets_.clear();
+        markDatabaseChanged();
     }
 
     void Recognition::saveDatabase(const std::string &filepath)
     {
-        std::ofstream ofs(filepath, std::ios::binary);
-        if (!ofs)
+        // Header with build parameters and number of shapes
+        const DatabaseParams params = database_.empty() ? getParameters() : databaseParams_;
+        if (writeDatabaseFile(filepath, params, database_.data(), database_.size()))
         {
-            std::cerr << "Error: Cannot open file for writing: " << filepath << std::endl;
-            return;
+            CSS_LOG_INFO("Database saved to: " << filepath);
         }
+    }
 
-        // Write number of shapes
-        size_t numShapes = database_.size();
-        ofs.write(reinterpret_cast<const char *>(&numShapes), sizeof(numShapes));
-
-        for (const auto &shape : database_)
+    bool Recognition::loadDatabase(const std::string &filepath)
+    {
+        // Read into a temporary so a bad file leaves the current database in place
+        DatabaseHeader header;
+        std::vector<ShapeEntry> shapes;
+        if (!readDatabaseFile(filepath, getParameters(), header, shapes))
         {
-            // Write name length and name
-            size_t nameLen = shape.name.size();
-            ofs.write(reinterpret_cast<const char *>(&nameLen), sizeof(nameLen));
-            ofs.write(shape.name.c_str(), nameLen);
+            return false;
+        }
 
-            // Write contour size and points
-            size_t contourSize = shape.contour.size();
-            ofs.write(reinterpret_cast<const char *>(&contourSize), sizeof(contourSize));
-            for (const auto &pt : shape.contour)
-            {
-                ofs.write(reinterpret_cast<const char *>(&pt.x), sizeof(pt.x));
-                ofs.write(reinterpret_cast<const char *>(&pt.y), sizeof(pt.y));
-            }
+        database_ = std::move(shapes);
+        shardOffsets_.clear();
 
-            // Write CSS zero crossings
-            size_t zcSize = shape.cssImage.zeroCrossings.size();
-            ofs.write(reinterpret_cast<const char *>(&zcSize), sizeof(zcSize));
-            for (const auto &zc : shape.cssImage.zeroCrossings)
-            {
-                ofs.write(reinterpret_cast<const char *>(&zc.first), sizeof(zc.first));
-                ofs.write(reinterpret_cast<const char *>(&zc.second), sizeof(zc.second));
-            }
+        if (header.legacy)
+        {
+            // No recorded parameters; assume the current configuration without resampling
+            CSS_LOG_WARNING("Legacy database without parameter header, assuming maxSigma="
+                            << maxSigma_ << ", numScales=" << numScales_);
         }
 
-        std::cout << "Database saved to: " << filepath << std::endl;
+        // Queries must use the parameters the database was built with
+        adoptParameters(header.params);
+
+        databaseParams_ = header.params;
+        databaseFingerprint_ = paramsFingerprint_;
+        markDatabaseChanged();
+
+        CSS_LOG_INFO("Database loaded: " << database_.size() << " shapes");
+        return true;
     }
 
-    void Recognition::loadDatabase(const std::string &filepath)
+    // ============================================================================
+    // Sharded Database
+    // ============================================================================
+
+    bool Recognition::saveShardedDatabase(const std::string &manifestPath, int numShards)
     {
-        std::ifstream ifs(filepath, std::ios::binary);
-        if (!ifs)
+        if (numShards < 1)
         {
-            std::cerr << "Error: Cannot open file for reading: " << filepath << std::endl;
-            return;
+            CSS_LOG_ERROR("Number of shards must be positive");
+            return false;
         }
 
-        clearDatabase();
+        const DatabaseParams params = database_.empty() ? getParameters() : databaseParams_;
+        const fs::path manifest(manifestPath);
+        const std::string stem = manifest.stem().string();
 
-        // Read number of shapes
-        size_t numShapes;
-        ifs.read(reinterpret_cast<char *>(&numShapes), sizeof(numShapes));
+        ShardManifest shardManifest;
+        shardManifest.fingerprint = params.fingerprint();
 
-        for (size_t i = 0; i < numShapes; i++)
+        // Contiguous, nearly equal slices of the database
+        const size_t total = database_.size();
+        const size_t shards = static_cast<size_t>(numShards);
+        for (size_t s = 0; s < shards; s++)
         {
-            ShapeEntry shape;
-
-            // Read name
-            size_t nameLen;
-            ifs.read(reinterpret_cast<char *>(&nameLen), sizeof(nameLen));
-            shape.name.resize(nameLen);
-            ifs.read(&shape.name[0], nameLen);
+            const size_t begin = total * s / shards;
+            const size_t end = total * (s + 1) / shards;
 
-            // Read contour
-            size_t contourSize;
-            ifs.read(reinterpret_cast<char *>(&contourSize), sizeof(contourSize));
-            shape.contour.resize(contourSize);
-            for (auto &pt : shape.contour)
+            std::string index = std::to_string(s);
+            std::string shardName = stem + ".shard" + std::string(index.size() < 3 ? 3 - index.size() : 0, '0') + index + ".dat";
+            if (!writeDatabaseFile((manifest.parent_path() / shardName).string(), params,
+                                   database_.data() + begin, end - begin))
             {
-                ifs.read(reinterpret_cast<char *>(&pt.x), sizeof(pt.x));
-                ifs.read(reinterpret_cast<char *>(&pt.y), sizeof(pt.y));
+                return false;
             }
+            shardManifest.shardPaths.push_back(shardName);
+        }
+
+        if (!writeShardManifest(manifestPath, shardManifest))
+        {
+            return false;
+        }
+
+        CSS_LOG_INFO("Database saved to: " << manifestPath << " (" << shards << " shards)");
+        return true;
+    }
+
+    bool Recognition::loadShardedDatabase(const std::string &manifestPath)
+    {
+        ShardManifest manifest;
+        if (!readShardManifest(manifestPath, manifest))
+        {
+            return false;
+        }
 
-            // Read CSS zero crossings
-            size_t zcSize;
-            ifs.read(reinterpret_cast<char *>(&zcSize), sizeof(zcSize));
-            shape.cssImage.zeroCrossings.resize(zcSize);
-            for (auto &zc : shape.cssImage.zeroCrossings)
+        // Read and validate all shards concurrently; the current database is replaced only on success
+        struct LoadedShard
+        {
+            bool ok = false;
+            DatabaseHeader header;
+            std::vector<ShapeEntry> shapes;
+        };
+        const DatabaseParams defaults = getParameters();
+        std::vector<LoadedShard> shards(manifest.shardPaths.size());
+        pool_->parallelFor(0, shards.size(), 1, [&manifest, &shards, &defaults](size_t begin, size_t end)
+                           {
+            for (size_t s = begin; s < end; s++)
             {
-                ifs.read(reinterpret_cast<char *>(&zc.first), sizeof(zc.first));
-                ifs.read(reinterpret_cast<char *>(&zc.second), sizeof(zc.second));
+                shards[s].ok = readDatabaseFile(manifest.shardPaths[s], defaults, shards[s].header, shards[s].shapes);
+            } });
+
+        for (size_t s = 0; s < shards.size(); s++)
+        {
+            const auto &shard = shards[s];
+            if (!shard.ok)
+            {
+                return false;
+            }
+            if (shard.header.legacy || shard.header.fingerprint != manifest.fingerprint)
+            {
+                CSS_LOG_ERROR("Shard parameters do not match manifest: " << manifest.shardPaths[s]);
+                return false;
             }
+        }
 
-            shape.cssImage.maxSigma = maxSigma_;
-            shape.cssImage.numScales = numScales_;
+        std::vector<ShapeEntry> shapes;
+        std::vector<size_t> offsets;
+        for (auto &shard : shards)
+        {
+            offsets.push_back(shapes.size());
+            shapes.insert(shapes.end(),
+                          std::make_move_iterator(shard.shapes.begin()),
+                          std::make_move_iterator(shard.shapes.end()));
+        }
+        database_ = std::move(shapes);
+        shardOffsets_ = std::move(offsets);
 
-            database_.push_back(shape);
+        if (!shards.empty())
+        {
+            adoptParameters(shards.front().header.params);
+            databaseParams_ = shards.front().header.params;
+            databaseFingerprint_ = paramsFingerprint_;
         }
+        markDatabaseChanged();
 
-        std::cout << "Database loaded: " << database_.size() << " shapes" << std::endl;
+        CSS_LOG_INFO("Database loaded: " << database_.size() << " shapes from "
+                     << shardOffsets_.size() << " shards");
+        return true;
     }
 
     // ============================================================================
@@ -253,58 +699,657 @@ namespace recognition
         return totalDist / seq1.size();
     }
 
+    double Recognition::toedDistance(const std::vector<std::pair<double, double>> &zc1,
+                                     const std::vector<std::pair<double, double>> &zc2, double bound)
+    {
+        // Runs once per database shape, so it is timed as part of recognition.match, not on its own
+        if (zc1.empty() || zc2.empty())
+        {
+            return std::numeric_limits<double>::max();
+        }
+
+        // Same matching distance as above; the square root is taken once per nearest neighbour
+        double totalDist = 0.0;
+        const std::pair<double, double> *b = zc2.data();
+        const size_t n2 = zc2.size();
+
+        // The sum only grows, so the mean is known to exceed bound once the sum passes this
+        // (with slack for rounding, so a shape exactly at the bound is still scored in full)
+        const double abortSum = bound < std::numeric_limits<double>::max() ? bound * zc1.size() * (1.0 + 1e-9)
+                                                                           : std::numeric_limits<double>::max();
+
+        for (const auto &pt1 : zc1)
+        {
+            double minDist2 = std::numeric_limits<double>::max();
+
+            for (size_t j = 0; j < n2; j++)
+            {
+                double da = pt1.first - b[j].first;
+                double ds = pt1.second - b[j].second;
+                minDist2 = std::min(minDist2, da * da + ds * ds);
+            }
+
+            totalDist += std::sqrt(minDist2);
+            if (totalDist > abortSum)
+            {
+                return std::numeric_limits<double>::max();
+            }
+        }
+
+        return totalDist / zc1.size();
+    }
+
     double Recognition::computeShapeDistance(const css::CSSImage &css1, const css::CSSImage &css2)
     {
-        auto seq1 = cssToSequences(css1);
-        auto seq2 = cssToSequences(css2);
-        return toedDistance(seq1, seq2);
+        return toedDistance(css1.zeroCrossings, css2.zeroCrossings);
     }
 
     std::vector<ShapeEntry> Recognition::recognizeShape(const cv::Mat &queryImage, int topK)
     {
-        // Extract contour from query image
-        auto contour = cssComputer_.extractContour(queryImage);
-
-        if (contour.empty())
+        CSS_TRACE_SCOPE("recognition.recognize_image");
+        // Reject before paying for contour extraction
+        if (!ensureCompatibleDatabase())
         {
-            std::cerr << "Error: Could not extract contour from query image" << std::endl;
             return std::vector<ShapeEntry>();
         }
 
-        return recognizeShape(contour, topK);
+        // Identical image bytes: answer without extracting the contour
+        const bool useCache = resultCache_.capacity() > 0;
+        uint64_t imageKey = 0;
+        std::vector<ShapeEntry> results;
+        if (useCache)
+        {
+            resultCache_.sync(databaseGeneration_);
+            imageKey = ResultCache::combine(ResultCache::hashImage(queryImage),
+                                            ResultCache::combine(paramsFingerprint_, static_cast<uint64_t>(topK)));
+            if (resultCache_.lookup(imageKey, results))
+            {
+                resultCache_.recordImageHit();
+                return results;
+            }
+        }
+
+        if (usesSubpixelContours())
+        {
+            // Subpixel curves rarely repeat exactly, so only the image-level cache applies
+            if (database_.empty())
+            {
+                CSS_LOG_ERROR("Database is empty!");
+                return std::vector<ShapeEntry>();
+            }
+
+            QueryShape shape;
+            css::CSSImage queryCSS;
+            if (!describeImage(queryImage, shape, queryCSS))
+            {
+                CSS_LOG_ERROR("Could not extract contour from query image");
+                return std::vector<ShapeEntry>();
+            }
+            results = matchDescriptor(queryCSS, topK);
+            if (useCache)
+            {
+                resultCache_.recordMiss();
+            }
+        }
+        else
+        {
+            // Extract contour from query image
+            auto contour = cssComputer_.extractContour(queryImage);
+
+            if (contour.empty())
+            {
+                CSS_LOG_ERROR("Could not extract contour from query image");
+                return std::vector<ShapeEntry>();
+            }
+
+            results = recognizeShape(contour, topK);
+        }
+
+        if (useCache && !results.empty())
+        {
+            resultCache_.insert(imageKey, results);
+        }
+
+        return results;
     }
 
     std::vector<ShapeEntry> Recognition::recognizeShape(const std::vector<cv::Point> &queryContour, int topK)
+    {
+        CSS_TRACE_SCOPE("recognition.recognize_shape");
+        if (resultCache_.capacity() == 0)
+        {
+            return matchContour(queryContour, topK);
+        }
+
+        // Near-identical images often yield the same contour
+        resultCache_.sync(databaseGeneration_);
+        const uint64_t contourKey = ResultCache::combine(ResultCache::hashContour(queryContour),
+                                                         ResultCache::combine(paramsFingerprint_, static_cast<uint64_t>(topK)));
+        std::vector<ShapeEntry> results;
+        if (resultCache_.lookup(contourKey, results))
+        {
+            resultCache_.recordContourHit();
+            return results;
+        }
+
+        results = matchContour(queryContour, topK);
+        if (!results.empty())
+        {
+            resultCache_.recordMiss();
+            resultCache_.insert(contourKey, results);
+        }
+
+        return results;
+    }
+
+    std::vector<std::pair<size_t, size_t>> Recognition::searchPartitions() const
+    {
+        // Minimum number of shapes worth a task of their own
+        const size_t minTaskSize = 8;
+
+        std::vector<size_t> offsets = shardOffsets_;
+        if (offsets.empty())
+        {
+            offsets.push_back(0);
+        }
+
+        // One task per shard, splitting shards that are much larger than a fair share
+        const size_t total = database_.size();
+        const size_t fairShare = std::max(minTaskSize, (total + pool_->size() - 1) / pool_->size());
+
+        std::vector<std::pair<size_t, size_t>> partitions;
+        for (size_t s = 0; s < offsets.size(); s++)
+        {
+            const size_t shardEnd = s + 1 < offsets.size() ? offsets[s + 1] : total;
+            for (size_t begin = offsets[s]; begin < shardEnd; begin += fairShare)
+            {
+                partitions.emplace_back(begin, std::min(begin + fairShare, shardEnd));
+            }
+        }
+
+        return partitions;
+    }
+
+    std::vector<ShapeEntry> Recognition::matchContour(const std::vector<cv::Point> &queryContour, int topK)
     {
         if (database_.empty())
         {
-            std::cerr << "Error: Database is empty!" << std::endl;
+            CSS_LOG_ERROR("Database is empty!");
+            return std::vector<ShapeEntry>();
+        }
+
+        if (!ensureCompatibleDatabase())
+        {
             return std::vector<ShapeEntry>();
         }
 
         // Compute CSS for query
-        css::CSSImage queryCSS = cssComputer_.computeCSS(queryContour, maxSigma_, numScales_);
+        return matchDescriptor(computeDescriptor(queryContour), topK);
+    }
+
+    std::vector<ShapeEntry> Recognition::matchDescriptor(const css::CSSImage &queryCSS, int topK, double bound)
+    {
+        CSS_PROFILE_SCOPE("recognition.match");
+        CSS_TRACE_SCOPE("recognition.match");
+        // Fan out over shard partitions; every task keeps its own top-K
+        const size_t k = topK < 0 ? database_.size() : static_cast<size_t>(topK);
+        const std::vector<std::pair<size_t, size_t>> partitions = searchPartitions();
+        std::vector<TopK<size_t>> locals(partitions.size(), TopK<size_t>(k));
+        pool_->parallelFor(0, partitions.size(), 1, [this, &queryCSS, &partitions, &locals, bound](size_t begin, size_t end)
+                           {
+            for (size_t p = begin; p < end; p++)
+            {
+                const auto &range = partitions[p];
+                CSS_TRACE_SCOPE_ARG("recognition.partition", "shapes", range.second - range.first);
+                TopK<size_t> &local = locals[p];
+                for (size_t i = range.first; i < range.second; i++)
+                {
+                    // Distances are abandoned as soon as they cannot enter the top-K
+                    const double limit = std::min(bound, local.worstScore());
+                    const double score = toedDistance(queryCSS.zeroCrossings, database_[i].cssImage.zeroCrossings, limit);
+                    if (score <= limit)
+                    {
+                        local.push(score, i);
+                    }
+                }
+                CSS_PROFILE_COUNT("recognition.distances", range.second - range.first);
+            } });
+
+        // Merge per-partition heaps
+        CSS_PROFILE_SCOPE("recognition.sort");
+        TopK<size_t> best(k);
+        for (auto &local : locals)
+        {
+            best.merge(std::move(local));
+        }
+
+        std::vector<ShapeEntry> results;
+        for (const auto &item : best.sorted())
+        {
+            results.push_back(database_[item.second]);
+            results.back().matchScore = item.first;
+        }
+
+        return results;
+    }
+
+    // ============================================================================
+    // Batch Recognition
+    // ============================================================================
 
-        // Compute distances to all shapes in database
-        std::vector<ShapeEntry> results = database_;
+    std::vector<std::vector<ShapeEntry>> Recognition::recognizeBatch(const std::vector<cv::Mat> &queryImages, int topK)
+    {
+        if (!ensureCompatibleDatabase())
+        {
+            return std::vector<std::vector<ShapeEntry>>(queryImages.size());
+        }
 
-#pragma omp parallel for if (results.size() > 10)
-        for (size_t i = 0; i < results.size(); i++)
+        if (usesSubpixelContours())
         {
-            results[i].matchScore = computeShapeDistance(queryCSS, results[i].cssImage);
+            return recognizeBatchSubpixel(queryImages, topK);
+        }
+
+        // Extract all query contours in parallel
+        std::vector<std::vector<cv::Point>> contours(queryImages.size());
+        pool_->parallelFor(0, queryImages.size(), 1, [this, &queryImages, &contours](size_t begin, size_t end)
+                           {
+            for (size_t q = begin; q < end; q++)
+            {
+                contours[q] = cssComputer_.extractContour(queryImages[q]);
+            } });
+
+        return recognizeBatch(contours, topK);
+    }
+
+    std::vector<std::vector<ShapeEntry>> Recognition::recognizeBatch(const std::vector<std::vector<cv::Point>> &queryContours,
+                                                                     int topK)
+    {
+        std::vector<std::vector<ShapeEntry>> results(queryContours.size());
+        if (database_.empty())
+        {
+            CSS_LOG_ERROR("Database is empty!");
+            return results;
+        }
+        if (!ensureCompatibleDatabase())
+        {
+            return results;
+        }
+
+        // Query descriptors in parallel
+        std::vector<css::CSSImage> queryCSS(queryContours.size());
+        pool_->parallelFor(0, queryContours.size(), 1, [this, &queryContours, &queryCSS](size_t begin, size_t end)
+                           {
+            for (size_t q = begin; q < end; q++)
+            {
+                if (!queryContours[q].empty())
+                {
+                    queryCSS[q] = computeDescriptor(queryContours[q]);
+                }
+            } });
+
+        results = matchBatch(queryCSS, topK);
+
+        // Queries without a contour get no matches
+        for (size_t q = 0; q < queryContours.size(); q++)
+        {
+            if (queryContours[q].empty())
+            {
+                CSS_LOG_WARNING("Could not extract contour for batch query " << q);
+                results[q].clear();
+            }
+        }
+
+        return results;
+    }
+
+    std::vector<std::vector<ShapeEntry>> Recognition::recognizeBatchSubpixel(const std::vector<cv::Mat> &queryImages,
+                                                                             int topK)
+    {
+        std::vector<std::vector<ShapeEntry>> results(queryImages.size());
+        if (database_.empty())
+        {
+            CSS_LOG_ERROR("Database is empty!");
+            return results;
+        }
+
+        // Every query runs TOED on a detector of its own; its rows spread over idle workers
+        std::vector<css::CSSImage> queryCSS(queryImages.size());
+        std::vector<char> found(queryImages.size(), 0);
+        pool_->parallelFor(0, queryImages.size(), 1, [this, &queryImages, &queryCSS, &found](size_t begin, size_t end)
+                           {
+            for (size_t q = begin; q < end; q++)
+            {
+                QueryShape shape;
+                found[q] = describeImage(queryImages[q], shape, queryCSS[q]);
+            } });
+
+        results = matchBatch(queryCSS, topK);
+        for (size_t q = 0; q < queryImages.size(); q++)
+        {
+            if (!found[q])
+            {
+                CSS_LOG_WARNING("Could not extract contour for batch query " << q);
+                results[q].clear();
+            }
         }
 
-        // Sort by distance (ascending)
-        std::sort(results.begin(), results.end(),
-                  [](const ShapeEntry &a, const ShapeEntry &b)
-                  {
-                      return a.matchScore < b.matchScore;
-                  });
+        return results;
+    }
+
+    std::vector<ObjectMatch> Recognition::recognizeObjects(const cv::Mat &image, int topK, double minAreaFraction)
+    {
+        std::vector<ObjectMatch> objects;
+        if (!ensureCompatibleDatabase())
+        {
+            return objects;
+        }
+
+        if (usesSubpixelContours())
+        {
+            return recognizeObjectsSubpixel(image, topK, minAreaFraction);
+        }
+
+        std::vector<std::vector<cv::Point>> contours = cssComputer_.extractContours(image, minAreaFraction);
+        if (contours.empty())
+        {
+            CSS_LOG_WARNING("No objects found in image");
+            return objects;
+        }
+
+        std::vector<std::vector<ShapeEntry>> matches = recognizeBatch(contours, topK);
+
+        objects.resize(contours.size());
+        for (size_t i = 0; i < contours.size(); i++)
+        {
+            objects[i].contour = std::move(contours[i]);
+            objects[i].matches = std::move(matches[i]);
+        }
+
+        return objects;
+    }
+
+    std::vector<ObjectMatch> Recognition::recognizeObjectsSubpixel(const cv::Mat &image, int topK,
+                                                                   double minAreaFraction)
+    {
+        std::vector<ObjectMatch> objects;
+        if (database_.empty())
+        {
+            CSS_LOG_ERROR("Database is empty!");
+            return objects;
+        }
+
+        std::vector<std::vector<cv::Point2d>> curves = cssComputer_.extractSubpixelContours(image, minAreaFraction);
+        if (curves.empty())
+        {
+            CSS_LOG_WARNING("No objects found in image");
+            return objects;
+        }
+
+        std::vector<css::CSSImage> queryCSS(curves.size());
+        pool_->parallelFor(0, curves.size(), 1, [this, &curves, &queryCSS](size_t begin, size_t end)
+                           {
+            for (size_t q = begin; q < end; q++)
+            {
+                queryCSS[q] = computeDescriptor(curves[q]);
+            } });
+
+        std::vector<std::vector<ShapeEntry>> matches = matchBatch(queryCSS, topK);
+
+        objects.resize(curves.size());
+        for (size_t i = 0; i < curves.size(); i++)
+        {
+            objects[i].contour = roundCurve(curves[i]);
+            objects[i].matches = std::move(matches[i]);
+        }
+
+        return objects;
+    }
+
+    std::vector<std::vector<ShapeEntry>> Recognition::matchBatch(const std::vector<css::CSSImage> &queryCSS, int topK)
+    {
+        CSS_PROFILE_SCOPE("recognition.match_batch");
+        // Tile sizes in zero crossings (16 bytes each); a query tile plus a database tile
+        // should stay resident in a per-core L2 cache
+        const size_t dbTileCrossings = 4096;
+        const size_t queryTileCrossings = 4096;
+
+        const size_t numQueries = queryCSS.size();
+        const size_t k = topK < 0 ? database_.size() : static_cast<size_t>(topK);
+
+        // Contiguous [begin, end) runs of items holding about maxCrossings zero crossings each
+        auto makeTiles = [](size_t begin, size_t end, size_t maxCrossings, auto crossingsOf)
+        {
+            std::vector<std::pair<size_t, size_t>> tiles;
+            size_t tileBegin = begin, crossings = 0;
+            for (size_t i = begin; i < end; i++)
+            {
+                crossings += crossingsOf(i);
+                if (crossings >= maxCrossings || i + 1 == end)
+                {
+                    tiles.emplace_back(tileBegin, i + 1);
+                    tileBegin = i + 1;
+                    crossings = 0;
+                }
+            }
+            return tiles;
+        };
+
+        // Query tiles are shared by all tasks
+        const std::vector<std::pair<size_t, size_t>> queryTiles =
+            makeTiles(0, numQueries, queryTileCrossings, [&queryCSS](size_t q)
+                      { return queryCSS[q].zeroCrossings.size(); });
+
+        // Each task keeps one query tile resident while it streams the database tiles of its range
+        // past it, then moves to the next query tile. Every query keeps its own TopK, whose k-th
+        // score bounds its distances so they are abandoned early as in matchDescriptor.
+        const std::vector<std::pair<size_t, size_t>> partitions = searchPartitions();
+        std::vector<std::vector<TopK<size_t>>> locals(partitions.size());
+        pool_->parallelFor(0, partitions.size(), 1, [this, &queryCSS, &queryTiles, &partitions, &locals, &makeTiles, k, numQueries](size_t begin, size_t end)
+                           {
+            for (size_t p = begin; p < end; p++)
+            {
+                const auto &range = partitions[p];
+                std::vector<TopK<size_t>> &local = locals[p];
+                local.assign(numQueries, TopK<size_t>(k));
+
+                const std::vector<std::pair<size_t, size_t>> dbTiles =
+                    makeTiles(range.first, range.second, dbTileCrossings, [this](size_t i)
+                              { return database_[i].cssImage.zeroCrossings.size(); });
+
+                for (const auto &queryTile : queryTiles)
+                {
+                    for (const auto &dbTile : dbTiles)
+                    {
+                        for (size_t q = queryTile.first; q < queryTile.second; q++)
+                        {
+                            TopK<size_t> &top = local[q];
+                            for (size_t i = dbTile.first; i < dbTile.second; i++)
+                            {
+                                const double limit = top.worstScore();
+                                const double score = toedDistance(queryCSS[q].zeroCrossings,
+                                                                  database_[i].cssImage.zeroCrossings, limit);
+                                if (score <= limit)
+                                {
+                                    top.push(score, i);
+                                }
+                            }
+                        }
+                    }
+                }
+                CSS_PROFILE_COUNT("recognition.distances", numQueries * (range.second - range.first));
+            } });
+
+        std::vector<TopK<size_t>> best(numQueries, TopK<size_t>(k));
+        for (auto &local : locals)
+        {
+            for (size_t q = 0; q < numQueries; q++)
+            {
+                best[q].merge(std::move(local[q]));
+            }
+        }
+
+        std::vector<std::vector<ShapeEntry>> results(numQueries);
+        for (size_t q = 0; q < numQueries; q++)
+        {
+            for (const auto &item : best[q].sorted())
+            {
+                results[q].push_back(database_[item.second]);
+                results[q].back().matchScore = item.first;
+            }
+        }
+
+        return results;
+    }
+
+    std::vector<ShapeEntry> Recognition::recognizeShapeStreamingShards(const std::string &manifestPath,
+                                                                       const std::vector<cv::Point> &queryContour,
+                                                                       int topK)
+    {
+        ShardManifest manifest;
+        if (!readShardManifest(manifestPath, manifest) || manifest.shardPaths.empty())
+        {
+            return std::vector<ShapeEntry>();
+        }
+
+        // Queries must use the parameters the shards were built with
+        if (manifest.fingerprint != paramsFingerprint_)
+        {
+            CSS_LOG_ERROR("Recognizer parameters do not match the sharded database; call useDatabaseParameters first");
+            return std::vector<ShapeEntry>();
+        }
+
+        css::CSSImage queryCSS = computeDescriptor(queryContour);
+
+        // One task per shard; a shard lives only while its task scores it
+        const size_t k = topK < 0 ? std::numeric_limits<size_t>::max() : static_cast<size_t>(topK);
+        const DatabaseParams params = getParameters();
+        const uint64_t fingerprint = manifest.fingerprint;
+        std::vector<TopK<ShapeEntry>> locals(manifest.shardPaths.size(), TopK<ShapeEntry>(k));
+        pool_->parallelFor(0, locals.size(), 1, [this, &queryCSS, &manifest, &locals, &params, fingerprint](size_t begin, size_t end)
+                           {
+            for (size_t s = begin; s < end; s++)
+            {
+                const std::string &path = manifest.shardPaths[s];
+                DatabaseHeader header;
+                std::vector<ShapeEntry> shapes;
+                if (!readDatabaseFile(path, params, header, shapes) || header.fingerprint != fingerprint)
+                {
+                    CSS_LOG_WARNING("Skipping unreadable or mismatched shard: " << path);
+                    continue;
+                }
+                for (auto &shape : shapes)
+                {
+                    double score = computeShapeDistance(queryCSS, shape.cssImage);
+                    if (locals[s].accepts(score))
+                    {
+                        locals[s].push(score, std::move(shape));
+                    }
+                }
+            } });
+
+        TopK<ShapeEntry> best(k);
+        for (auto &local : locals)
+        {
+            best.merge(std::move(local));
+        }
+
+        std::vector<ShapeEntry> results;
+        for (auto &item : best.sorted())
+        {
+            results.push_back(std::move(item.second));
+            results.back().matchScore = item.first;
+        }
+
+        return results;
+    }
+
+    std::vector<ShapeEntry> Recognition::recognizeShapeStreaming(const std::string &filepath,
+                                                                 const cv::Mat &queryImage,
+                                                                 int topK,
+                                                                 size_t chunkSize)
+    {
+        // Extraction must already use the database parameters, so check the header first
+        DatabaseReader reader;
+        if (!reader.open(filepath, getParameters()) || !checkStreamingParameters(reader.header().params))
+        {
+            return std::vector<ShapeEntry>();
+        }
+
+        QueryShape shape;
+        css::CSSImage queryCSS;
+        if (!describeImage(queryImage, shape, queryCSS))
+        {
+            CSS_LOG_ERROR("Could not extract contour from query image");
+            return std::vector<ShapeEntry>();
+        }
+
+        return streamDescriptor(reader, queryCSS, topK, chunkSize);
+    }
+
+    std::vector<ShapeEntry> Recognition::recognizeShapeStreaming(const std::string &filepath,
+                                                                 const std::vector<cv::Point> &queryContour,
+                                                                 int topK,
+                                                                 size_t chunkSize)
+    {
+        DatabaseReader reader;
+        if (!reader.open(filepath, getParameters()) || !checkStreamingParameters(reader.header().params))
+        {
+            return std::vector<ShapeEntry>();
+        }
+
+        return streamDescriptor(reader, computeDescriptor(queryContour), topK, chunkSize);
+    }
+
+    std::vector<ShapeEntry> Recognition::streamDescriptor(DatabaseReader &reader, const css::CSSImage &queryCSS,
+                                                          int topK, size_t chunkSize)
+    {
+        chunkSize = std::max<size_t>(chunkSize, 1);
+
+        const size_t k = topK < 0 ? std::numeric_limits<size_t>::max() : static_cast<size_t>(topK);
+        TopK<ShapeEntry> best(k);
+
+        // Double buffering: while `current` is scored, the I/O thread fills `next`
+        std::vector<ShapeEntry> current, next;
+        std::vector<double> scores;
+        reader.readChunk(current, chunkSize);
+
+        while (!current.empty())
+        {
+            std::future<size_t> readAhead = std::async(std::launch::async, [&reader, &next, chunkSize]()
+                                                       { return reader.readChunk(next, chunkSize); });
+
+            // Score the current chunk across the pool; small grains let idle workers balance it
+            scores.resize(current.size());
+            const size_t grain = std::max<size_t>(1, current.size() / (4 * pool_->size()));
+            pool_->parallelFor(0, current.size(), grain, [this, &queryCSS, &current, &scores](size_t begin, size_t end)
+                               {
+                for (size_t i = begin; i < end; i++)
+                {
+                    scores[i] = computeShapeDistance(queryCSS, current[i].cssImage);
+                } });
+
+            for (size_t i = 0; i < current.size(); i++)
+            {
+                if (best.accepts(scores[i]))
+                {
+                    best.push(scores[i], current[i]);
+                }
+            }
+
+            readAhead.get();
+            std::swap(current, next);
+        }
+
+        if (reader.failed())
+        {
+            return std::vector<ShapeEntry>();
+        }
 
-        // Return top K matches
-        if (topK < results.size())
+        std::vector<ShapeEntry> results;
+        for (auto &item : best.sorted())
         {
-            results.resize(topK);
+            results.push_back(std::move(item.second));
+            results.back().matchScore = item.first;
         }
 
         return results;
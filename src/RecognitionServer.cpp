@@ -0,0 +1,622 @@
+#include "RecognitionServer.h"
+#include "Logging.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <sstream>
+
+namespace recognition
+{
+
+    namespace
+    {
+        bool readAll(int fd, uint8_t *data, size_t size)
+        {
+            while (size > 0)
+            {
+                const ssize_t n = ::recv(fd, data, size, 0);
+                if (n <= 0)
+                {
+                    return false;
+                }
+                data += n;
+                size -= static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        bool writeAll(int fd, const uint8_t *data, size_t size)
+        {
+            while (size > 0)
+            {
+                const ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+                if (n <= 0)
+                {
+                    return false;
+                }
+                data += n;
+                size -= static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        bool readFrame(int fd, std::vector<uint8_t> &frame, uint32_t maxBytes)
+        {
+            uint32_t length = 0;
+            if (!readAll(fd, reinterpret_cast<uint8_t *>(&length), sizeof(length)))
+            {
+                return false;
+            }
+            length = ntohl(length);
+            if (length > maxBytes)
+            {
+                CSS_LOG_WARNING("Request of " << length << " bytes exceeds the limit, closing connection");
+                return false;
+            }
+            frame.resize(length);
+            return readAll(fd, frame.data(), frame.size());
+        }
+
+        bool writeFrame(int fd, const uint8_t *data, size_t size)
+        {
+            const uint32_t length = htonl(static_cast<uint32_t>(size));
+            return writeAll(fd, reinterpret_cast<const uint8_t *>(&length), sizeof(length)) &&
+                   writeAll(fd, data, size);
+        }
+
+        // recv and send on fd give up after timeoutMs without progress
+        void setTimeouts(int fd, int timeoutMs)
+        {
+            timeval timeout;
+            timeout.tv_sec = timeoutMs / 1000;
+            timeout.tv_usec = (timeoutMs % 1000) * 1000;
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        }
+
+        std::string jsonEscape(const std::string &text)
+        {
+            std::string out;
+            for (char c : text)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    out += '\\';
+                }
+                out += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+            }
+            return out;
+        }
+
+        std::string errorResponse(const std::string &message)
+        {
+            return "{\"status\": \"error\", \"message\": \"" + jsonEscape(message) + "\"}";
+        }
+
+        // Removes a socket file left at path; false if something other than a socket is there
+        bool removeSocketFile(const std::string &path)
+        {
+            struct stat st;
+            if (::lstat(path.c_str(), &st) != 0)
+            {
+                return errno == ENOENT;
+            }
+            if (!S_ISSOCK(st.st_mode))
+            {
+                return false;
+            }
+            return ::unlink(path.c_str()) == 0 || errno == ENOENT;
+        }
+
+        // Socket bound to the endpoint (listening) or connected to it; -1 on failure
+        int openSocket(const ServerOptions &endpoint, bool listening)
+        {
+            if (endpoint.tcpPort > 0)
+            {
+                const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+                if (fd < 0)
+                {
+                    return -1;
+                }
+
+                sockaddr_in addr;
+                std::memset(&addr, 0, sizeof(addr));
+                addr.sin_family = AF_INET;
+                addr.sin_port = htons(static_cast<uint16_t>(endpoint.tcpPort));
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+                if (listening)
+                {
+                    const int reuse = 1;
+                    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+                }
+                const int rc = listening ? ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr))
+                                         : ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+                if (rc < 0)
+                {
+                    ::close(fd);
+                    return -1;
+                }
+                return fd;
+            }
+
+            sockaddr_un addr;
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            if (endpoint.socketPath.empty() || endpoint.socketPath.size() >= sizeof(addr.sun_path))
+            {
+                return -1;
+            }
+            std::strncpy(addr.sun_path, endpoint.socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+            const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+            {
+                return -1;
+            }
+            if (listening && !removeSocketFile(endpoint.socketPath))
+            {
+                // A stale socket file from an earlier run would make bind fail; anything else is kept
+                CSS_LOG_ERROR("Refusing to replace " << endpoint.socketPath << ", which is not a socket");
+                ::close(fd);
+                errno = EEXIST;
+                return -1;
+            }
+            const int rc = listening ? ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr))
+                                     : ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+            if (rc < 0)
+            {
+                ::close(fd);
+                return -1;
+            }
+            return fd;
+        }
+    }
+
+    RecognitionServer::RecognitionServer(std::shared_ptr<Recognition> recognizer, const ServerOptions &options)
+        : handle_(std::move(recognizer)),
+          options_(options),
+          reloadPending_(false),
+          reloading_(false),
+          reloadShutdown_(false),
+          listenFd_(-1),
+          wakeFds_{-1, -1},
+          stopping_(false),
+          requestsServed_(0)
+    {
+        reloadThread_ = std::thread(&RecognitionServer::reloadLoop, this);
+    }
+
+    RecognitionServer::~RecognitionServer()
+    {
+        stop();
+        {
+            std::lock_guard<std::mutex> lock(reloadMutex_);
+            reloadShutdown_ = true;
+        }
+        reloadCv_.notify_all();
+        reloadThread_.join();
+    }
+
+    bool RecognitionServer::start()
+    {
+        if (listenFd_ >= 0)
+        {
+            CSS_LOG_ERROR("Server is already running");
+            return false;
+        }
+
+        listenFd_ = openSocket(options_, true);
+        if (listenFd_ < 0 || ::listen(listenFd_, SOMAXCONN) < 0 || ::pipe2(wakeFds_, O_NONBLOCK | O_CLOEXEC) < 0)
+        {
+            CSS_LOG_ERROR("Cannot listen on " << (options_.tcpPort > 0 ? "127.0.0.1:" + std::to_string(options_.tcpPort)
+                                                                       : options_.socketPath)
+                                              << ": " << std::strerror(errno));
+            if (listenFd_ >= 0)
+            {
+                ::close(listenFd_);
+                listenFd_ = -1;
+            }
+            return false;
+        }
+
+        // Request handlers run on the recognizer's threads and CPUs. Each runs its request serially
+        // (see serveRequest), so the workers alone keep those CPUs busy.
+        parallel::ExecutionContext context = handle_.acquire()->getExecutionContext();
+        if (options_.numWorkers > 0)
+        {
+            context.numThreads = options_.numWorkers;
+        }
+
+        stopping_ = false;
+        workers_ = std::make_unique<parallel::ThreadPool>(context);
+        eventThread_ = std::thread(&RecognitionServer::eventLoop, this);
+        CSS_LOG_INFO("Serving " << handle_.acquire()->getDatabaseSize() << " shapes on "
+                                << (options_.tcpPort > 0 ? "127.0.0.1:" + std::to_string(options_.tcpPort)
+                                                         : options_.socketPath)
+                                << " with " << workers_->size() << " workers");
+        return true;
+    }
+
+    void RecognitionServer::stop()
+    {
+        if (listenFd_ < 0)
+        {
+            return;
+        }
+
+        stopping_ = true;
+        eventThread_.join();
+        ::close(listenFd_);
+        listenFd_ = -1;
+
+        // Wake tasks blocked on their connection, then close the ones the event loop was polling
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex_);
+            for (int fd : connections_)
+            {
+                ::shutdown(fd, SHUT_RDWR);
+            }
+        }
+        workers_.reset();
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex_);
+            for (int fd : connections_)
+            {
+                ::close(fd);
+            }
+            connections_.clear();
+            returned_.clear();
+        }
+        ::close(wakeFds_[0]);
+        ::close(wakeFds_[1]);
+        wakeFds_[0] = wakeFds_[1] = -1;
+
+        if (options_.tcpPort <= 0)
+        {
+            removeSocketFile(options_.socketPath);
+        }
+        CSS_LOG_INFO("Server stopped after " << requestsServed_ << " requests");
+    }
+
+    void RecognitionServer::eventLoop()
+    {
+        typedef std::chrono::steady_clock Clock;
+
+        // Connections waiting for their next request
+        std::vector<int> idle, waiting;
+        std::vector<pollfd> fds;
+
+        // When accept fails for lack of descriptors or memory the pending connection stays queued
+        // and the listen socket readable, so it is left out of the poll for a while instead
+        Clock::time_point acceptPausedUntil;
+        while (!stopping_)
+        {
+            {
+                std::lock_guard<std::mutex> lock(connectionsMutex_);
+                idle.insert(idle.end(), returned_.begin(), returned_.end());
+                returned_.clear();
+            }
+
+            fds.assign(2, pollfd());
+            fds[0].fd = Clock::now() < acceptPausedUntil ? -1 : listenFd_; // poll skips negative fds
+            fds[1].fd = wakeFds_[0];
+            for (int fd : idle)
+            {
+                fds.push_back(pollfd());
+                fds.back().fd = fd;
+            }
+            for (auto &pfd : fds)
+            {
+                pfd.events = POLLIN;
+            }
+
+            // Poll with a timeout so stop() is noticed without closing the socket under accept
+            if (::poll(fds.data(), fds.size(), 200) <= 0)
+            {
+                continue;
+            }
+
+            if (fds[1].revents != 0)
+            {
+                char drain[64];
+                while (::read(wakeFds_[0], drain, sizeof(drain)) > 0)
+                {
+                }
+            }
+
+            // A readable connection (or one the client closed) is handed to a task for one request
+            waiting.clear();
+            for (size_t i = 2; i < fds.size(); i++)
+            {
+                const int fd = fds[i].fd;
+                if (fds[i].revents == 0)
+                {
+                    waiting.push_back(fd);
+                    continue;
+                }
+                workers_->submit([this, fd]()
+                                 { serveRequest(fd); });
+            }
+            idle.swap(waiting);
+
+            if (fds[0].revents & POLLIN)
+            {
+                const int fd = ::accept(listenFd_, nullptr, nullptr);
+                if (fd < 0)
+                {
+                    if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED)
+                    {
+                        CSS_LOG_WARNING("Cannot accept connections: " << std::strerror(errno) << ", pausing for 1 s");
+                        acceptPausedUntil = Clock::now() + std::chrono::seconds(1);
+                    }
+                    continue;
+                }
+
+                // A client that stalls inside a request gives its worker back after the timeout
+                setTimeouts(fd, options_.requestTimeoutMs);
+
+                std::lock_guard<std::mutex> lock(connectionsMutex_);
+                connections_.insert(fd);
+                idle.push_back(fd);
+            }
+        }
+    }
+
+    void RecognitionServer::serveRequest(int fd)
+    {
+        // Requests already run side by side, one per worker; the loops of this one stay on this
+        // worker instead of adding the recognizer's threads on the same CPUs
+        parallel::SerialScope serial;
+
+        bool open = false;
+        bool failed = false;
+        std::string failure;
+        try
+        {
+            std::vector<uint8_t> request;
+            open = !stopping_ && readFrame(fd, request, options_.maxRequestBytes);
+            if (open)
+            {
+                const std::string response = handleRequest(request);
+                open = writeFrame(fd, reinterpret_cast<const uint8_t *>(response.data()), response.size());
+            }
+        }
+        catch (const std::exception &e)
+        {
+            failed = true;
+            failure = e.what();
+        }
+        catch (...)
+        {
+            failed = true;
+            failure = "unknown exception";
+        }
+
+        // The client is answered instead of left waiting, then dropped: part of the request may
+        // still be unread, so the stream cannot be trusted for another one
+        if (failed)
+        {
+            CSS_LOG_ERROR("Request failed: " << failure);
+            const std::string response = errorResponse("internal error: " + failure);
+            writeFrame(fd, reinterpret_cast<const uint8_t *>(response.data()), response.size());
+            open = false;
+        }
+        if (!open || stopping_)
+        {
+            closeConnection(fd);
+            return;
+        }
+
+        // Back to the event loop for the next request
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex_);
+            returned_.push_back(fd);
+        }
+        const char wake = 1;
+        const ssize_t written = ::write(wakeFds_[1], &wake, 1);
+        (void)written; // a full pipe already wakes the loop
+    }
+
+    void RecognitionServer::closeConnection(int fd)
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        connections_.erase(fd);
+        ::close(fd);
+    }
+
+    std::string RecognitionServer::handleRequest(const std::vector<uint8_t> &request)
+    {
+        typedef std::chrono::steady_clock Clock;
+        const Clock::time_point start = Clock::now();
+
+        if (request.size() < 2)
+        {
+            return errorResponse("truncated request");
+        }
+        const uint8_t kind = request[0];
+        const int topK = request[1] > 0 ? request[1] : 5;
+        const uint8_t *payload = request.data() + 2;
+        const size_t payloadSize = request.size() - 2;
+
+        if (kind == RequestReload)
+        {
+            const std::string path(payload, payload + payloadSize);
+            if (!requestReload(path))
+            {
+                return errorResponse("a reload is already in progress");
+            }
+            return "{\"status\": \"ok\", \"message\": \"reloading " + jsonEscape(path) + "\"}";
+        }
+
+        // This request keeps its snapshot even if a reload swaps the recognizer meanwhile
+        const RecognizerSnapshot snapshot = handle_.snapshot();
+        const std::shared_ptr<Recognition> &recognizer = snapshot.recognizer;
+        const uint64_t version = snapshot.version;
+
+        std::vector<ShapeEntry> matches;
+        if (kind == RequestImage)
+        {
+            cv::Mat image = cv::imdecode(std::vector<uchar>(payload, payload + payloadSize), cv::IMREAD_COLOR);
+            if (image.empty())
+            {
+                return errorResponse("cannot decode image");
+            }
+            matches = recognizer->recognizeShape(image, topK);
+        }
+        else if (kind == RequestContour)
+        {
+            if (payloadSize == 0 || payloadSize % 8 != 0)
+            {
+                return errorResponse("contour payload must hold int32 x, y pairs");
+            }
+
+            std::vector<cv::Point> contour(payloadSize / 8);
+            for (size_t i = 0; i < contour.size(); i++)
+            {
+                uint32_t xy[2];
+                std::memcpy(xy, payload + 8 * i, sizeof(xy));
+                contour[i] = cv::Point(static_cast<int32_t>(ntohl(xy[0])), static_cast<int32_t>(ntohl(xy[1])));
+            }
+            matches = recognizer->recognizeShape(contour, topK);
+        }
+        else
+        {
+            return errorResponse("unknown request kind " + std::to_string(kind));
+        }
+
+        const double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        requestsServed_++;
+        CSS_LOG_COUNT("server.requests", 1);
+
+        std::ostringstream json;
+        json << "{\"status\": \"ok\", \"database_version\": " << version << ", \"latency_ms\": " << latencyMs
+             << ", \"matches\": [";
+        for (size_t i = 0; i < matches.size(); i++)
+        {
+            json << (i ? ", " : "") << "{\"name\": \"" << jsonEscape(matches[i].name)
+                 << "\", \"distance\": " << matches[i].matchScore << "}";
+        }
+        json << "]}";
+        return json.str();
+    }
+
+    bool RecognitionServer::reloadInProgress() const
+    {
+        std::lock_guard<std::mutex> lock(reloadMutex_);
+        return reloading_;
+    }
+
+    bool RecognitionServer::requestReload(const std::string &databasePath)
+    {
+        {
+            std::lock_guard<std::mutex> lock(reloadMutex_);
+            if (reloading_ || reloadShutdown_)
+            {
+                return false;
+            }
+            reloading_ = true;
+            reloadPending_ = true;
+            pendingReload_ = databasePath;
+        }
+        reloadCv_.notify_one();
+        return true;
+    }
+
+    void RecognitionServer::reloadLoop()
+    {
+        std::unique_lock<std::mutex> lock(reloadMutex_);
+        while (true)
+        {
+            reloadCv_.wait(lock, [this]()
+                           { return reloadShutdown_ || reloadPending_; });
+            if (reloadShutdown_)
+            {
+                return;
+            }
+            const std::string databasePath = pendingReload_;
+            reloadPending_ = false;
+            lock.unlock();
+
+            // Loaded off the request path; queries keep using the current recognizer meanwhile.
+            // The replacement runs on the same threads and CPUs. Nothing a bad file throws may
+            // leave this thread, or it would take the whole server down.
+            bool published = false;
+            try
+            {
+                auto fresh = std::make_shared<Recognition>(handle_.acquire()->getExecutionContext());
+                const bool sharded = databasePath.size() > 7 &&
+                                     databasePath.compare(databasePath.size() - 7, 7, ".shards") == 0;
+                const bool loaded = sharded ? fresh->loadShardedDatabase(databasePath) : fresh->loadDatabase(databasePath);
+                if (loaded && fresh->getDatabaseSize() > 0)
+                {
+                    handle_.publish(std::move(fresh));
+                    published = true;
+                }
+            }
+            catch (const std::exception &e)
+            {
+                CSS_LOG_ERROR("Reload of " << databasePath << " threw: " << e.what());
+            }
+            catch (...)
+            {
+                CSS_LOG_ERROR("Reload of " << databasePath << " threw an unknown exception");
+            }
+
+            if (!published)
+            {
+                CSS_LOG_ERROR("Reload of " << databasePath << " failed, keeping the current database");
+            }
+
+            lock.lock();
+            reloading_ = false;
+        }
+    }
+
+    // ============================================================================
+    // Client
+    // ============================================================================
+
+    bool sendRecognitionRequest(const ServerOptions &endpoint, RequestKind kind, int topK,
+                                const std::vector<uint8_t> &payload, std::string &response)
+    {
+        const int fd = openSocket(endpoint, false);
+        if (fd < 0)
+        {
+            CSS_LOG_ERROR("Cannot connect to recognition server: " << std::strerror(errno));
+            return false;
+        }
+
+        // A server that stops answering fails the request instead of hanging the client
+        setTimeouts(fd, endpoint.requestTimeoutMs);
+
+        std::vector<uint8_t> request;
+        request.reserve(payload.size() + 2);
+        request.push_back(kind);
+        request.push_back(static_cast<uint8_t>(std::max(0, std::min(topK, 255))));
+        request.insert(request.end(), payload.begin(), payload.end());
+
+        std::vector<uint8_t> reply;
+        const bool ok = writeFrame(fd, request.data(), request.size()) &&
+                        readFrame(fd, reply, std::numeric_limits<uint32_t>::max());
+        ::close(fd);
+        if (ok)
+        {
+            response.assign(reply.begin(), reply.end());
+        }
+        return ok;
+    }
+
+} // namespace recognition
@@ -0,0 +1,28 @@
+#include "RecognizerHandle.h"
+#include "Logging.h"
+
+namespace recognition
+{
+
+    RecognizerHandle::RecognizerHandle(std::shared_ptr<Recognition> recognizer)
+        : current_(std::make_shared<const RecognizerSnapshot>(RecognizerSnapshot{std::move(recognizer), 0}))
+    {
+    }
+
+    RecognizerSnapshot RecognizerHandle::snapshot() const
+    {
+        return *std::atomic_load(&current_);
+    }
+
+    void RecognizerHandle::publish(std::shared_ptr<Recognition> recognizer)
+    {
+        std::lock_guard<std::mutex> lock(publishMutex_);
+        const uint64_t version = std::atomic_load(&current_)->version + 1;
+        const size_t shapes = recognizer->getDatabaseSize();
+
+        // Queries still holding the previous recognizer finish on it; the last of them frees it
+        std::atomic_store(&current_, std::make_shared<const RecognizerSnapshot>(RecognizerSnapshot{std::move(recognizer), version}));
+        CSS_LOG_INFO("Published recognizer version " << version << " (" << shapes << " shapes)");
+    }
+
+} // namespace recognition
@@ -0,0 +1,177 @@
+#include "ResultCache.h"
+#include <cstring>
+
+namespace recognition
+{
+
+    namespace
+    {
+        // Word-at-a-time multiplicative hash; fast enough to run on full-resolution frames
+        uint64_t hashBytes(const unsigned char *data, size_t length, uint64_t h)
+        {
+            const uint64_t prime = 0x100000001b3ULL;
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8)
+            {
+                uint64_t word;
+                std::memcpy(&word, data + i, sizeof(word));
+                h = (h ^ word) * prime;
+                h ^= h >> 29;
+            }
+            for (; i < length; i++)
+            {
+                h = (h ^ data[i]) * prime;
+            }
+            return h;
+        }
+    }
+
+    ResultCache::ResultCache(size_t capacity) : capacity_(capacity), generation_(0) {}
+
+    void ResultCache::setCapacity(size_t capacity)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = capacity;
+        evictToCapacity();
+    }
+
+    size_t ResultCache::capacity() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return capacity_;
+    }
+
+    void ResultCache::sync(uint64_t databaseGeneration)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (databaseGeneration == generation_)
+        {
+            return;
+        }
+
+        generation_ = databaseGeneration;
+        if (!lru_.empty())
+        {
+            lru_.clear();
+            index_.clear();
+            stats_.invalidations++;
+        }
+    }
+
+    bool ResultCache::lookup(uint64_t key, std::vector<ShapeEntry> &results)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end())
+        {
+            return false;
+        }
+
+        // Move to front
+        lru_.splice(lru_.begin(), lru_, it->second);
+        results = it->second->second;
+        return true;
+    }
+
+    void ResultCache::insert(uint64_t key, const std::vector<ShapeEntry> &results)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (capacity_ == 0)
+        {
+            return;
+        }
+
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            it->second->second = results;
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return;
+        }
+
+        lru_.emplace_front(key, results);
+        index_[key] = lru_.begin();
+        evictToCapacity();
+    }
+
+    void ResultCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lru_.clear();
+        index_.clear();
+    }
+
+    void ResultCache::evictToCapacity()
+    {
+        while (lru_.size() > capacity_)
+        {
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+            stats_.evictions++;
+        }
+    }
+
+    void ResultCache::recordImageHit()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.imageHits++;
+    }
+
+    void ResultCache::recordContourHit()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.contourHits++;
+    }
+
+    void ResultCache::recordMiss()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.misses++;
+    }
+
+    CacheStats ResultCache::stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    void ResultCache::resetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_ = CacheStats();
+    }
+
+    // ============================================================================
+    // Hashing
+    // ============================================================================
+
+    uint64_t ResultCache::hashImage(const cv::Mat &image)
+    {
+        // Geometry and type first, so images with equal bytes but different layout differ
+        uint64_t h = 14695981039346656037ULL;
+        h = combine(h, static_cast<uint64_t>(image.rows));
+        h = combine(h, static_cast<uint64_t>(image.cols));
+        h = combine(h, static_cast<uint64_t>(image.type()));
+
+        const size_t rowBytes = image.cols * image.elemSize();
+        for (int r = 0; r < image.rows; r++)
+        {
+            h = hashBytes(image.ptr<unsigned char>(r), rowBytes, h);
+        }
+        return h;
+    }
+
+    uint64_t ResultCache::hashContour(const std::vector<cv::Point> &contour)
+    {
+        uint64_t h = combine(14695981039346656037ULL, contour.size());
+        return hashBytes(reinterpret_cast<const unsigned char *>(contour.data()),
+                         contour.size() * sizeof(cv::Point), h);
+    }
+
+    uint64_t ResultCache::combine(uint64_t hash, uint64_t value)
+    {
+        // boost::hash_combine, widened to 64 bits
+        return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 12) + (hash >> 4));
+    }
+
+} // namespace recognition
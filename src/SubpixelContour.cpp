@@ -0,0 +1,299 @@
+#include "SubpixelContour.h"
+#include "Logging.h"
+#include "ThreadPool.h"
+#include "toed/edge_grid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace css
+{
+
+    namespace
+    {
+        // Linking tolerances, in pixels of the detector image. Edges are clustered first, which
+        // leaves roughly one edge per 1-2 px along a curve.
+        const double kLinkRadius = 2.5;       // farthest step between consecutive chain edges
+        const double kMaxTurnDegrees = 30.0;  // largest tangent change between consecutive edges
+        const double kCloseRadius = 4.0;      // chain ends closer than this close the curve
+        const size_t kMinChainEdges = 12;     // shorter chains are texture or noise
+
+        // Idle detectors kept beyond the workers of the pool (the caller's own)
+        const size_t kSpareDetectors = 1;
+
+        // Follow the tangent of edge `from` (reversed when dir < 0) and return the index of the
+        // next edge of the chain, or -1 at an end
+        int nextEdge(const std::vector<Edge> &edges, const EdgeGrid &grid, const std::vector<char> &visited,
+                     int from, double dir)
+        {
+            const Edge &e = edges[from];
+            const double tx = std::cos(e.orientation), ty = std::sin(e.orientation);
+            const double minAlignment = std::cos(kMaxTurnDegrees * CV_PI / 180.0);
+
+            int best = -1;
+            double bestCost = std::numeric_limits<double>::max();
+            grid.for_each_neighbor(e.location, kLinkRadius, [&](int j)
+                                   {
+                if (j == from || visited[j])
+                {
+                    return;
+                }
+
+                const double vx = edges[j].location.x - e.location.x;
+                const double vy = edges[j].location.y - e.location.y;
+                if (dir * (vx * tx + vy * ty) <= 0.0)
+                {
+                    return;
+                }
+
+                // Tangents of one curve point the same way, whichever way it is walked
+                const double alignment = std::cos(edges[j].orientation) * tx + std::sin(edges[j].orientation) * ty;
+                if (alignment < minAlignment)
+                {
+                    return;
+                }
+
+                // Prefer close edges straight ahead over ones off to the side
+                const double cost = std::sqrt(vx * vx + vy * vy) + 2.0 * std::abs(vx * ty - vy * tx);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    best = j;
+                } });
+
+            return best;
+        }
+
+        double polygonArea(const std::vector<cv::Point2d> &curve)
+        {
+            double twiceArea = 0.0;
+            for (size_t i = 0, n = curve.size(); i < n; i++)
+            {
+                const cv::Point2d &a = curve[i];
+                const cv::Point2d &b = curve[(i + 1) % n];
+                twiceArea += a.x * b.y - b.x * a.y;
+            }
+            return std::abs(twiceArea) / 2.0;
+        }
+    }
+
+    // ============================================================================
+    // Edge Linking
+    // ============================================================================
+
+    std::vector<EdgeChain> linkEdges(const std::vector<Edge> &edges, cv::Size imageSize)
+    {
+        // Cells about the link radius wide: each step scans at most 3x3 cells
+        EdgeGrid grid(imageSize.height, imageSize.width, kLinkRadius);
+        grid.build(edges);
+
+        std::vector<char> visited(edges.size(), 0);
+        std::vector<EdgeChain> chains;
+        std::vector<int> backward;
+        for (size_t seed = 0; seed < edges.size(); seed++)
+        {
+            if (visited[seed])
+            {
+                continue;
+            }
+            visited[seed] = 1;
+
+            // Walk backwards first so the chain can be assembled in tangent order
+            backward.clear();
+            for (int cur = static_cast<int>(seed);;)
+            {
+                cur = nextEdge(edges, grid, visited, cur, -1.0);
+                if (cur < 0)
+                {
+                    break;
+                }
+                visited[cur] = 1;
+                backward.push_back(cur);
+            }
+
+            EdgeChain chain;
+            chain.edges.assign(backward.rbegin(), backward.rend());
+            chain.edges.push_back(static_cast<int>(seed));
+            for (int cur = static_cast<int>(seed);;)
+            {
+                cur = nextEdge(edges, grid, visited, cur, 1.0);
+                if (cur < 0)
+                {
+                    break;
+                }
+                visited[cur] = 1;
+                chain.edges.push_back(cur);
+            }
+
+            if (chain.edges.size() < kMinChainEdges)
+            {
+                continue;
+            }
+
+            const cv::Point2d &first = edges[chain.edges.front()].location;
+            const cv::Point2d &last = edges[chain.edges.back()].location;
+            chain.closed = std::hypot(first.x - last.x, first.y - last.y) <= kCloseRadius;
+            chains.push_back(std::move(chain));
+        }
+
+        std::sort(chains.begin(), chains.end(), [](const EdgeChain &a, const EdgeChain &b)
+                  { return a.edges.size() > b.edges.size(); });
+        return chains;
+    }
+
+    // ============================================================================
+    // Subpixel Contour Extraction
+    // ============================================================================
+
+    SubpixelContourExtractor::SubpixelContourExtractor() {}
+
+    SubpixelContourExtractor::~SubpixelContourExtractor() {}
+
+    void SubpixelContourExtractor::setThreadPool(std::shared_ptr<parallel::ThreadPool> pool)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pool_ = std::move(pool);
+    }
+
+    SubpixelContourExtractor::Detector SubpixelContourExtractor::acquireDetector(cv::Size size)
+    {
+        Detector detector;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = std::find_if(idle_.begin(), idle_.end(), [size](const Detector &d)
+                                   { return d.size == size; });
+            if (it != idle_.end())
+            {
+                detector = std::move(*it);
+                idle_.erase(it);
+            }
+        }
+
+        if (!detector.toed)
+        {
+            detector.size = size;
+            detector.toed = std::make_unique<ThirdOrderEdgeDetectionCPU>(size.height, size.width);
+        }
+        return detector;
+    }
+
+    void SubpixelContourExtractor::releaseDetector(Detector detector)
+    {
+        // At most one idle detector per thread that can call extract() at once; the oldest go first
+        std::lock_guard<std::mutex> lock(mutex_);
+        const size_t capacity = (pool_ ? pool_->size() : 0) + kSpareDetectors;
+        idle_.push_back(std::move(detector));
+        if (idle_.size() > capacity)
+        {
+            idle_.erase(idle_.begin(), idle_.end() - capacity);
+        }
+    }
+
+    std::vector<std::vector<cv::Point2d>> SubpixelContourExtractor::extract(const cv::Mat &image,
+                                                                            const ContourParams &params,
+                                                                            double minAreaFraction)
+    {
+        std::vector<std::vector<cv::Point2d>> curves;
+
+        // Same resolution policy as the threshold path
+        cv::Mat scaled, converted;
+        const cv::Mat *gray = &image;
+        double scaleX = 1.0, scaleY = 1.0;
+        if (params.maxDimension > 0 && std::max(image.rows, image.cols) > params.maxDimension)
+        {
+            const double factor = params.maxDimension / static_cast<double>(std::max(image.rows, image.cols));
+            cv::Size newSize(std::max(1, cvRound(image.cols * factor)), std::max(1, cvRound(image.rows * factor)));
+            cv::resize(image, scaled, newSize, 0, 0, cv::INTER_AREA);
+            scaleX = image.cols / static_cast<double>(newSize.width);
+            scaleY = image.rows / static_cast<double>(newSize.height);
+            gray = &scaled;
+        }
+        if (gray->channels() == 3)
+        {
+            cv::cvtColor(*gray, converted, cv::COLOR_BGR2GRAY);
+            gray = &converted;
+        }
+
+        const cv::Size size(gray->cols, gray->rows);
+        std::shared_ptr<parallel::ThreadPool> pool;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pool = pool_;
+        }
+        Detector detector = acquireDetector(size);
+        detector.toed->pool = pool.get();
+        detector.toed->get_Third_Order_Edges(*gray);
+
+        // Merge duplicate responses of the interpolated detector grid before linking
+        const std::vector<Edge> &toedEdges = detector.toed->toed_edges;
+        EdgeGrid grid(size.height, size.width, GRID_SIZE);
+        grid.build(toedEdges);
+        const std::vector<Edge> edges = cluster_edges(toedEdges, grid);
+
+        std::vector<EdgeChain> chains = linkEdges(edges, size);
+        CSS_LOG_DEBUG("TOED: " << toedEdges.size() << " edges, " << edges.size()
+                      << " clusters linked into " << chains.size() << " chains");
+        CSS_LOG_COUNT("css.toed.edges", toedEdges.size());
+        releaseDetector(std::move(detector));
+
+        // Areas are compared in the working image
+        const double minArea = minAreaFraction * size.area();
+        std::vector<std::pair<double, size_t>> kept;
+        std::vector<std::vector<cv::Point2d>> candidates;
+        for (const auto &chain : chains)
+        {
+            if (!chain.closed)
+            {
+                continue;
+            }
+
+            std::vector<cv::Point2d> curve;
+            curve.reserve(chain.edges.size());
+            for (int idx : chain.edges)
+            {
+                curve.push_back(edges[idx].location);
+            }
+
+            const double area = polygonArea(curve);
+            if (area >= minArea)
+            {
+                kept.push_back({area, candidates.size()});
+                candidates.push_back(std::move(curve));
+            }
+        }
+
+        std::sort(kept.begin(), kept.end(), [](const std::pair<double, size_t> &a, const std::pair<double, size_t> &b)
+                  { return a.first > b.first; });
+        for (const auto &k : kept)
+        {
+            curves.push_back(std::move(candidates[k.second]));
+        }
+
+        // An object cut by the detector border leaves no closed chain; fall back to the longest one
+        if (curves.empty() && minAreaFraction <= 0.0 && !chains.empty())
+        {
+            CSS_LOG_COUNT("css.toed.open_fallback", 1);
+            curves.emplace_back();
+            for (int idx : chains.front().edges)
+            {
+                curves.back().push_back(edges[idx].location);
+            }
+        }
+
+        // Map pixel centres of the working image back to input coordinates
+        if (scaleX != 1.0 || scaleY != 1.0)
+        {
+            for (auto &curve : curves)
+            {
+                for (auto &pt : curve)
+                {
+                    pt.x = (pt.x + 0.5) * scaleX - 0.5;
+                    pt.y = (pt.y + 0.5) * scaleY - 0.5;
+                }
+            }
+        }
+
+        return curves;
+    }
+
+} // namespace css
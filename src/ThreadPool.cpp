@@ -0,0 +1,233 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <exception>
+
+namespace parallel
+{
+
+    namespace
+    {
+        // Pool and deque index of the current thread when it is a worker
+        struct WorkerSlot
+        {
+            const ThreadPool *pool = nullptr;
+            size_t index = 0;
+        };
+
+        thread_local WorkerSlot t_worker;
+
+        // Set while a SerialScope is alive on the current thread
+        thread_local bool t_serial = false;
+
+        // Shared by the helpers of one parallelFor; outlives the call for helpers that start late
+        struct Loop
+        {
+            const std::function<void(size_t, size_t)> *body = nullptr;
+            size_t begin = 0, end = 0, grain = 1, chunks = 0;
+            std::atomic<size_t> next{0};
+
+            std::mutex mutex;
+            std::condition_variable done;
+            size_t finished = 0;
+            std::exception_ptr error;
+
+            // Claims and runs one chunk; false once every chunk has been claimed
+            bool runChunk()
+            {
+                const size_t chunk = next.fetch_add(1, std::memory_order_relaxed);
+                if (chunk >= chunks)
+                {
+                    return false;
+                }
+
+                const size_t chunkBegin = begin + chunk * grain;
+                try
+                {
+                    (*body)(chunkBegin, std::min(chunkBegin + grain, end));
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (++finished == chunks)
+                {
+                    done.notify_all();
+                }
+                return true;
+            }
+        };
+    }
+
+    ThreadPool::ThreadPool(size_t numThreads) : ThreadPool(ExecutionContext{numThreads})
+    {
+    }
+
+    ThreadPool::ThreadPool(const ExecutionContext &context) : context_(context), queued_(0), stopping_(false)
+    {
+        const size_t numThreads = context_.resolvedThreads();
+
+        for (size_t i = 0; i <= numThreads; i++)
+        {
+            queues_.push_back(std::make_unique<WorkQueue>());
+        }
+
+        workers_.reserve(numThreads);
+        for (size_t i = 0; i < numThreads; i++)
+        {
+            workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+
+        for (auto &worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    bool ThreadPool::isWorker() const
+    {
+        return t_worker.pool == this;
+    }
+
+    void ThreadPool::schedule(std::function<void()> task)
+    {
+        WorkQueue &queue = *queues_[isWorker() ? t_worker.index : size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queued_.fetch_add(1, std::memory_order_relaxed);
+        }
+        cv_.notify_one();
+    }
+
+    bool ThreadPool::runOne(size_t index)
+    {
+        std::function<void()> task;
+        auto take = [&task](WorkQueue &queue, bool newest)
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+            {
+                return false;
+            }
+            task = std::move(newest ? queue.tasks.back() : queue.tasks.front());
+            newest ? queue.tasks.pop_back() : queue.tasks.pop_front();
+            return true;
+        };
+
+        // Own deque newest first, then the injection queue, then the oldest task of another worker
+        const size_t numWorkers = size();
+        bool found = take(*queues_[index], true) || take(*queues_[numWorkers], false);
+        for (size_t offset = 1; !found && offset < numWorkers; offset++)
+        {
+            found = take(*queues_[(index + offset) % numWorkers], false);
+        }
+        if (!found)
+        {
+            return false;
+        }
+
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        task();
+        return true;
+    }
+
+    void ThreadPool::workerLoop(size_t index)
+    {
+        t_worker.pool = this;
+        t_worker.index = index;
+        context_.pin(index);
+
+        while (true)
+        {
+            if (runOne(index))
+            {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]()
+                     { return stopping_ || queued_.load(std::memory_order_relaxed) > 0; });
+
+            // Drain remaining tasks before shutting down
+            if (stopping_ && queued_.load(std::memory_order_relaxed) == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain,
+                                 const std::function<void(size_t, size_t)> &body)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+        grain = std::max<size_t>(grain, 1);
+        const size_t chunks = (end - begin + grain - 1) / grain;
+
+        // A worker runs the whole range itself when nested loops are serial or nobody could help
+        const bool worker = isWorker();
+        if (chunks == 1 || t_serial || (worker && (context_.nested == NestedPolicy::Serial || size() == 1)))
+        {
+            body(begin, end);
+            return;
+        }
+
+        auto loop = std::make_shared<Loop>();
+        loop->body = &body;
+        loop->begin = begin;
+        loop->end = end;
+        loop->grain = grain;
+        loop->chunks = chunks;
+
+        // The caller takes chunks too, so the loop finishes even when every worker is busy or
+        // blocked (e.g. on a lock the caller holds); it then only waits for chunks in progress
+        const size_t helpers = std::min(worker ? size() - 1 : size(), chunks - 1);
+        for (size_t h = 0; h < helpers; h++)
+        {
+            schedule([loop]()
+                     { while (loop->runChunk()) {} });
+        }
+        while (loop->runChunk())
+        {
+        }
+
+        std::unique_lock<std::mutex> lock(loop->mutex);
+        loop->done.wait(lock, [&loop]()
+                        { return loop->finished == loop->chunks; });
+        if (loop->error)
+        {
+            std::rethrow_exception(loop->error);
+        }
+    }
+
+    SerialScope::SerialScope() : previous_(t_serial)
+    {
+        t_serial = true;
+    }
+
+    SerialScope::~SerialScope()
+    {
+        t_serial = previous_;
+    }
+
+} // namespace parallel
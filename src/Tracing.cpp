@@ -0,0 +1,154 @@
+#include "Tracing.h"
+#include "Logging.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tracing
+{
+
+    namespace detail
+    {
+        std::atomic<bool> g_active{false};
+    }
+
+    namespace
+    {
+        const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+        // Written only by its thread; head counts every event ever appended
+        struct Buffer
+        {
+            std::vector<Event> events;
+            std::atomic<uint64_t> head{0};
+            int tid = 0;
+        };
+
+        // A thread's buffer is tied to one trace; start() bumps the generation so threads register
+        // fresh buffers, while ones still writing keep their old buffer alive through the shared_ptr
+        std::mutex g_mutex;
+        std::vector<std::shared_ptr<Buffer>> g_buffers;
+        std::atomic<size_t> g_capacity{1 << 16};
+        std::atomic<uint64_t> g_generation{0};
+
+        struct LocalBuffer
+        {
+            std::shared_ptr<Buffer> buffer;
+            uint64_t generation = 0;
+        };
+
+        Buffer &localBuffer()
+        {
+            thread_local LocalBuffer local;
+            const uint64_t generation = g_generation.load(std::memory_order_acquire);
+            if (!local.buffer || local.generation != generation)
+            {
+                // Allocated outside the lock; only the registration is serialized
+                auto buffer = std::make_shared<Buffer>();
+                buffer->events.resize(g_capacity.load(std::memory_order_relaxed));
+                std::lock_guard<std::mutex> lock(g_mutex);
+                buffer->tid = static_cast<int>(g_buffers.size()) + 1;
+                g_buffers.push_back(buffer);
+                local.buffer = buffer;
+                local.generation = generation;
+            }
+            return *local.buffer;
+        }
+    }
+
+    namespace detail
+    {
+        uint64_t nowNs()
+        {
+            // Offset by one so 0 can mean "not recording"
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::steady_clock::now() - g_epoch)
+                                             .count()) +
+                   1;
+        }
+
+        void append(const Event &event)
+        {
+            Buffer &buffer = localBuffer();
+            const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+            buffer.events[head % buffer.events.size()] = event;
+            buffer.head.store(head + 1, std::memory_order_release);
+        }
+    }
+
+    void start(size_t eventsPerThread)
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_buffers.clear();
+        g_capacity = std::max<size_t>(eventsPerThread, 1);
+        g_generation.fetch_add(1, std::memory_order_release);
+        detail::g_active.store(true, std::memory_order_relaxed);
+    }
+
+    void stop()
+    {
+        detail::g_active.store(false, std::memory_order_relaxed);
+    }
+
+    size_t eventCount()
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        size_t count = 0;
+        for (const auto &buffer : g_buffers)
+        {
+            count += std::min<uint64_t>(buffer->head.load(std::memory_order_acquire), buffer->events.size());
+        }
+        return count;
+    }
+
+    bool writeChromeTrace(const std::string &filepath)
+    {
+        std::ofstream out(filepath);
+        if (!out)
+        {
+            CSS_LOG_ERROR("Cannot write trace: " << filepath);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(g_mutex);
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        bool first = true;
+        uint64_t overwritten = 0;
+        for (const auto &buffer : g_buffers)
+        {
+            const uint64_t head = buffer->head.load(std::memory_order_acquire);
+            const uint64_t capacity = buffer->events.size();
+            const uint64_t begin = head > capacity ? head - capacity : 0;
+            overwritten += begin;
+
+            out << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+                << buffer->tid << ", \"args\": {\"name\": \"thread " << buffer->tid << "\"}}";
+            first = false;
+
+            // Names are string literals from the instrumented code, no escaping needed
+            for (uint64_t i = begin; i < head; i++)
+            {
+                const Event &event = buffer->events[i % capacity];
+                out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->tid
+                    << ", \"ts\": " << event.startNs / 1000.0 << ", \"dur\": " << event.durationNs / 1000.0;
+                if (event.argName)
+                {
+                    out << ", \"args\": {\"" << event.argName << "\": " << event.arg << "}";
+                }
+                out << "}";
+            }
+        }
+        out << "\n]}\n";
+
+        if (overwritten > 0)
+        {
+            CSS_LOG_WARNING("Trace ring buffers wrapped, " << overwritten << " oldest events were dropped");
+        }
+        return static_cast<bool>(out);
+    }
+
+} // namespace tracing
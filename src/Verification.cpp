@@ -0,0 +1,503 @@
+#include "Verification.h"
+#include "CSS.h"
+#include "Recognition.h"
+#include "ThreadPool.h"
+#include "toed/cpu_toed.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
+
+namespace verification
+{
+
+    namespace
+    {
+        // Closed curve around (300, 300) with random low-frequency lobes
+        std::vector<cv::Point2d> randomCurve(std::mt19937 &rng, int n)
+        {
+            std::uniform_real_distribution<double> amp(0.0, 0.15), phase(0.0, 2.0 * CV_PI);
+            double a[6], p[6];
+            for (int h = 0; h < 6; h++)
+            {
+                a[h] = amp(rng);
+                p[h] = phase(rng);
+            }
+
+            std::vector<cv::Point2d> curve(n);
+            for (int i = 0; i < n; i++)
+            {
+                const double t = 2.0 * CV_PI * i / n;
+                double r = 150.0;
+                for (int h = 0; h < 6; h++)
+                {
+                    r += 150.0 * a[h] * std::cos((h + 2) * t + p[h]);
+                }
+                curve[i] = cv::Point2d(300.0 + r * std::cos(t), 300.0 + r * std::sin(t));
+            }
+            return curve;
+        }
+
+        std::vector<std::pair<double, double>> randomZeroCrossings(std::mt19937 &rng, size_t count)
+        {
+            std::uniform_real_distribution<double> arc(0.0, 1.0), sigma(0.0, 4.0);
+            std::vector<std::pair<double, double>> zc(count);
+            for (auto &p : zc)
+            {
+                p = {arc(rng), sigma(rng)};
+            }
+            return zc;
+        }
+
+        // Filled random polygon on a noisy background, so every TOED filter tap sees structure
+        cv::Mat randomImage(std::mt19937 &rng, int height, int width)
+        {
+            cv::Mat image(height, width, CV_8UC1, cv::Scalar(220));
+            std::uniform_real_distribution<double> radius(0.2, 0.45);
+            std::vector<cv::Point> polygon;
+            for (int i = 0; i < 9; i++)
+            {
+                const double t = 2.0 * CV_PI * i / 9;
+                const double r = radius(rng) * std::min(height, width);
+                polygon.emplace_back(cvRound(width / 2.0 + r * std::cos(t)), cvRound(height / 2.0 + r * std::sin(t)));
+            }
+            cv::fillPoly(image, std::vector<std::vector<cv::Point>>{polygon}, cv::Scalar(40), cv::LINE_AA);
+
+            std::uniform_int_distribution<int> noise(-10, 10);
+            for (int r = 0; r < height; r++)
+            {
+                for (int c = 0; c < width; c++)
+                {
+                    image.at<uchar>(r, c) = static_cast<uchar>(std::clamp(image.at<uchar>(r, c) + noise(rng), 0, 255));
+                }
+            }
+            return image;
+        }
+
+        void append(std::vector<double> &target, const std::vector<double> &values)
+        {
+            target.insert(target.end(), values.begin(), values.end());
+        }
+
+        std::vector<double> copyMap(const double *data, size_t size)
+        {
+            return std::vector<double>(data, data + size);
+        }
+
+        // Derivative of the given order (0..3) of a unit-area Gaussian, from its closed form
+        double gaussianDerivative(int order, double x, double sigma)
+        {
+            const double s2 = sigma * sigma;
+            const double g = std::exp(-x * x / (2.0 * s2)) / (std::sqrt(2.0 * CV_PI) * sigma);
+            switch (order)
+            {
+            case 0:
+                return g;
+            case 1:
+                return -x / s2 * g;
+            case 2:
+                return (x * x - s2) / (s2 * s2) * g;
+            default:
+                return x * (3.0 * s2 - x * x) / (s2 * s2 * s2) * g;
+            }
+        }
+
+        // TOED responses on the 2x upsampled grid, straight from their definition. Output (2i+dy, 2j+dx)
+        // is the image convolved with Gaussian derivatives centred half a pixel right (dx) and down
+        // (dy) of pixel (i, j), over 17 taps on the pixel and 19 taps at half-pixel positions. The
+        // orientation is that of T = grad(g' H g), with g the gradient and H the Hessian, rotated a
+        // quarter turn. Fills Ix, Iy, grad_mag and orient.
+        void referenceConvolution(const cv::Mat &image, std::vector<double> maps[4])
+        {
+            const double sigma = 2.0; // scale of the detector's tabulated kernels
+            const int height = image.rows, width = image.cols;
+            const size_t interpWidth = 2 * static_cast<size_t>(width);
+            for (int a = 0; a < 4; a++)
+            {
+                maps[a].assign(4 * static_cast<size_t>(height) * width, 0.0);
+            }
+
+            // kernel[shifted][order][radius + t]: the taps at offset t (+ 0.5 when shifted)
+            const int maxRadius = 9;
+            std::vector<double> kernel[2][4];
+            for (int shifted = 0; shifted < 2; shifted++)
+            {
+                for (int order = 0; order < 4; order++)
+                {
+                    for (int t = -maxRadius; t <= maxRadius; t++)
+                    {
+                        kernel[shifted][order].push_back(gaussianDerivative(order, t + 0.5 * shifted, sigma));
+                    }
+                }
+            }
+
+            for (int i = 0; i < height; i++)
+            {
+                for (int j = 0; j < width; j++)
+                {
+                    for (int dy = 0; dy < 2; dy++)
+                    {
+                        for (int dx = 0; dx < 2; dx++)
+                        {
+                            const int radius = dx || dy ? maxRadius : maxRadius - 1;
+
+                            // d[a][b]: response to the a-th x derivative times the b-th y derivative
+                            double d[4][4] = {};
+                            for (int p = -radius; p <= radius; p++)
+                            {
+                                for (int q = -radius; q <= radius; q++)
+                                {
+                                    if (i - p < 0 || j - q < 0 || i - p >= height || j - q >= width)
+                                    {
+                                        continue;
+                                    }
+                                    const double v = image.at<uchar>(i - p, j - q);
+                                    for (int a = 0; a <= 3; a++)
+                                    {
+                                        for (int b = 0; a + b <= 3; b++)
+                                        {
+                                            d[a][b] += v * kernel[dx][a][q + maxRadius] * kernel[dy][b][p + maxRadius];
+                                        }
+                                    }
+                                }
+                            }
+
+                            const double gx = d[1][0], gy = d[0][1];
+                            const double hxx = d[2][0], hxy = d[1][1], hyy = d[0][2];
+
+                            // grad(g' H g) = 2 H H g + (g' dH/dx g, g' dH/dy g)
+                            const double hgx = hxx * gx + hxy * gy, hgy = hxy * gx + hyy * gy;
+                            const double tx = 2.0 * (hxx * hgx + hxy * hgy) +
+                                              gx * gx * d[3][0] + 2.0 * gx * gy * d[2][1] + gy * gy * d[1][2];
+                            const double ty = 2.0 * (hxy * hgx + hyy * hgy) +
+                                              gx * gx * d[2][1] + 2.0 * gx * gy * d[1][2] + gy * gy * d[0][3];
+
+                            const size_t at = (2 * static_cast<size_t>(i) + dy) * interpWidth + 2 * j + dx;
+                            maps[0][at] = gx;
+                            maps[1][at] = gy;
+                            maps[2][at] = std::hypot(gx, gy);
+                            maps[3][at] = std::atan2(tx, -ty);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Moves each reference angle by a whole turn where that brings it closer to the candidate
+        void unwrapAngles(std::vector<double> &reference, const std::vector<double> &candidate)
+        {
+            for (size_t i = 0; i < reference.size() && i < candidate.size(); i++)
+            {
+                if (reference[i] - candidate[i] > CV_PI)
+                {
+                    reference[i] -= 2.0 * CV_PI;
+                }
+                else if (candidate[i] - reference[i] > CV_PI)
+                {
+                    reference[i] += 2.0 * CV_PI;
+                }
+            }
+        }
+    }
+
+    // ============================================================================
+    // Comparison and report
+    // ============================================================================
+
+    ArrayError compareArrays(const std::string &kernel, const std::string &array,
+                             const std::vector<double> &reference, const std::vector<double> &candidate,
+                             double tolerance, bool relative)
+    {
+        ArrayError error;
+        error.kernel = kernel;
+        error.array = array;
+        error.size = reference.size();
+        error.tolerance = tolerance;
+        error.relative = relative;
+
+        if (reference.size() != candidate.size())
+        {
+            error.maxError = error.meanError = std::numeric_limits<double>::infinity();
+            return error;
+        }
+
+        double sum = 0.0;
+        for (size_t i = 0; i < reference.size(); i++)
+        {
+            double diff = reference[i] == candidate[i] ? 0.0 : std::abs(reference[i] - candidate[i]);
+            if (relative)
+            {
+                diff /= std::max(1.0, std::abs(reference[i]));
+            }
+            error.maxError = std::max(error.maxError, std::isnan(diff) ? std::numeric_limits<double>::infinity() : diff);
+            sum += diff;
+        }
+        error.meanError = reference.empty() ? 0.0 : sum / reference.size();
+        return error;
+    }
+
+    bool VerificationReport::passed() const
+    {
+        return std::all_of(arrays.begin(), arrays.end(), [](const ArrayError &e)
+                           { return e.passed(); });
+    }
+
+    std::string VerificationReport::format() const
+    {
+        std::ostringstream os;
+        os << std::left << std::setw(26) << "kernel" << std::setw(12) << "array" << std::right << std::setw(9)
+           << "size" << std::setw(13) << "max err" << std::setw(13) << "mean err" << std::setw(11) << "tolerance"
+           << "  status\n";
+        for (const auto &e : arrays)
+        {
+            os << std::left << std::setw(26) << e.kernel << std::setw(12) << e.array << std::right << std::setw(9)
+               << e.size << std::scientific << std::setprecision(3) << std::setw(13) << e.maxError
+               << std::setw(13) << e.meanError << std::setprecision(0) << std::setw(11) << e.tolerance
+               << std::defaultfloat << "  " << (e.passed() ? "ok" : "FAIL") << (e.relative ? " (relative)" : "") << "\n";
+        }
+        return os.str();
+    }
+
+    // ============================================================================
+    // Reference kernels
+    // ============================================================================
+
+    void referenceDerivatives(const std::vector<cv::Point2d> &contour, double sigma,
+                              std::vector<double> &dx, std::vector<double> &dy,
+                              std::vector<double> &d2x, std::vector<double> &d2y)
+    {
+        // Same truncation as CSS::computeDerivativesWithGaussian: odd width ceil(6 sigma), at least 3
+        int width = static_cast<int>(std::ceil(6 * sigma));
+        width += width % 2 == 0 ? 1 : 0;
+        width = std::max(width, 3);
+        const int half = width / 2;
+
+        long double norm = 0.0L;
+        for (int u = -half; u <= half; u++)
+        {
+            norm += std::exp(-(u * u) / (2.0L * sigma * sigma));
+        }
+
+        const int n = static_cast<int>(contour.size());
+        dx.assign(n, 0.0);
+        dy.assign(n, 0.0);
+        d2x.assign(n, 0.0);
+        d2y.assign(n, 0.0);
+        for (int i = 0; i < n; i++)
+        {
+            long double sx = 0.0L, sy = 0.0L, sxx = 0.0L, syy = 0.0L;
+            for (int u = -half; u <= half; u++)
+            {
+                const long double s2 = static_cast<long double>(sigma) * sigma;
+                const long double g = std::exp(-(u * u) / (2.0L * s2)) / norm;
+                const long double gu = -(u / s2) * g;
+                const long double guu = ((u * u) / (s2 * s2) - 1.0L / s2) * g;
+                const cv::Point2d &p = contour[((i + u) % n + n) % n];
+                sx += p.x * gu;
+                sy += p.y * gu;
+                sxx += p.x * guu;
+                syy += p.y * guu;
+            }
+            dx[i] = static_cast<double>(sx);
+            dy[i] = static_cast<double>(sy);
+            d2x[i] = static_cast<double>(sxx);
+            d2y[i] = static_cast<double>(syy);
+        }
+    }
+
+    std::vector<double> curvature(const std::vector<double> &dx, const std::vector<double> &dy,
+                                  const std::vector<double> &d2x, const std::vector<double> &d2y)
+    {
+        std::vector<double> k(dx.size());
+        for (size_t i = 0; i < dx.size(); i++)
+        {
+            const double denominator = std::pow(dx[i] * dx[i] + dy[i] * dy[i], 1.5);
+            k[i] = denominator > 1e-10 ? (dx[i] * d2y[i] - dy[i] * d2x[i]) / denominator : 0.0;
+        }
+        return k;
+    }
+
+    // ============================================================================
+    // Kernel families
+    // ============================================================================
+
+    void verifyDerivatives(VerificationReport &report, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        css::CSS cssComputer;
+
+        // Every (size, sigma) case, concatenated per output array. Integer contours are compared
+        // against the reference on the same rounded points.
+        const char *names[5] = {"dx", "dy", "d2x", "d2y", "curvature"};
+        std::vector<double> reference[5], subpixel[5], roundedReference[5], integer[5];
+        for (int n : {64, 257, 1024})
+        {
+            const std::vector<cv::Point2d> curve = randomCurve(rng, n);
+            std::vector<cv::Point> rounded;
+            std::vector<cv::Point2d> roundedCurve;
+            for (const auto &p : curve)
+            {
+                rounded.emplace_back(cvRound(p.x), cvRound(p.y));
+                roundedCurve.emplace_back(rounded.back().x, rounded.back().y);
+            }
+
+            for (double sigma : {0.3, 1.0, 2.5, 4.0, 8.0})
+            {
+                std::vector<double> r[4], d[4], rr[4], c[4];
+                referenceDerivatives(curve, sigma, r[0], r[1], r[2], r[3]);
+                cssComputer.computeDerivativesWithGaussian(curve, sigma, d[0], d[1], d[2], d[3]);
+                referenceDerivatives(roundedCurve, sigma, rr[0], rr[1], rr[2], rr[3]);
+                cssComputer.computeDerivativesWithGaussian(rounded, sigma, c[0], c[1], c[2], c[3]);
+
+                for (int a = 0; a < 4; a++)
+                {
+                    append(reference[a], r[a]);
+                    append(subpixel[a], d[a]);
+                    append(roundedReference[a], rr[a]);
+                    append(integer[a], c[a]);
+                }
+                append(reference[4], curvature(r[0], r[1], r[2], r[3]));
+                append(subpixel[4], curvature(d[0], d[1], d[2], d[3]));
+                append(roundedReference[4], curvature(rr[0], rr[1], rr[2], rr[3]));
+                append(integer[4], curvature(c[0], c[1], c[2], c[3]));
+            }
+        }
+
+        for (int a = 0; a < 5; a++)
+        {
+            // Curvature divides by |X'|^3, which magnifies rounding where the curve is nearly
+            // stationary, so it is compared relative to its magnitude
+            const bool relative = a == 4;
+            report.arrays.push_back(compareArrays("derivatives<Point2d>", names[a], reference[a], subpixel[a], 1e-9, relative));
+            report.arrays.push_back(compareArrays("derivatives<Point>", names[a], roundedReference[a], integer[a], 1e-9, relative));
+        }
+    }
+
+    void verifyDistances(VerificationReport &report, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<size_t> count(0, 300);
+        recognition::Recognition recognizer;
+
+        std::vector<double> reference, unbounded, atBound, pruned, prunedExpected;
+        for (int pair = 0; pair < 200; pair++)
+        {
+            css::CSSImage a, b;
+            a.zeroCrossings = randomZeroCrossings(rng, count(rng));
+            b.zeroCrossings = randomZeroCrossings(rng, count(rng));
+
+            const double ref = recognizer.toedDistance(recognizer.cssToSequences(a), recognizer.cssToSequences(b));
+            reference.push_back(ref);
+            unbounded.push_back(recognition::Recognition::toedDistance(a.zeroCrossings, b.zeroCrossings));
+
+            // A shape exactly at the bound must still be scored in full; one well above it is abandoned
+            atBound.push_back(recognition::Recognition::toedDistance(a.zeroCrossings, b.zeroCrossings, ref));
+            if (ref > 0.0 && ref < std::numeric_limits<double>::max())
+            {
+                pruned.push_back(recognition::Recognition::toedDistance(a.zeroCrossings, b.zeroCrossings, 0.5 * ref));
+                prunedExpected.push_back(std::numeric_limits<double>::max());
+            }
+        }
+
+        report.arrays.push_back(compareArrays("toed_distance", "distance", reference, unbounded, 1e-12));
+        report.arrays.push_back(compareArrays("toed_distance(bound=d)", "distance", reference, atBound, 1e-12));
+        report.arrays.push_back(compareArrays("toed_distance(bound=d/2)", "abandoned", prunedExpected, pruned, 0.0));
+    }
+
+    void verifyConvolution(VerificationReport &report, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        const char *names[4] = {"Ix", "Iy", "grad_mag", "orient"};
+        std::vector<double> direct[4], reference[4], candidate[4];
+
+        // Fixed worker count, so rows are split across threads even on a single core
+        const size_t threads = 4;
+        parallel::ThreadPool pool(threads);
+
+        for (const cv::Size size : {cv::Size(64, 48), cv::Size(160, 120)})
+        {
+            const cv::Mat image = randomImage(rng, size.height, size.width);
+
+            ThirdOrderEdgeDetectionCPU serial(size.height, size.width);
+            serial.preprocessing(image);
+            serial.convolve_img();
+
+            ThirdOrderEdgeDetectionCPU pooled(size.height, size.width);
+            pooled.pool = &pool;
+            pooled.preprocessing(image);
+            pooled.convolve_img();
+
+            std::vector<double> maps[4];
+            referenceConvolution(image, maps);
+
+            const size_t n = static_cast<size_t>(serial.get_interp_img_height()) * serial.get_interp_img_width();
+            const double *serialMaps[4] = {serial.get_Ix(), serial.get_Iy(), serial.get_I_grad_mag(), serial.get_I_orient()};
+            const double *pooledMaps[4] = {pooled.get_Ix(), pooled.get_Iy(), pooled.get_I_grad_mag(),
+                                           pooled.get_I_orient()};
+            for (int a = 0; a < 4; a++)
+            {
+                append(direct[a], maps[a]);
+                append(reference[a], copyMap(serialMaps[a], n));
+                append(candidate[a], copyMap(pooledMaps[a], n));
+            }
+        }
+
+        // The tabulated kernels match the closed forms to about 15 digits; the orientation is
+        // compared modulo a full turn, since atan2 may land on either side of +-pi
+        unwrapAngles(direct[3], reference[3]);
+        const double tolerances[4] = {1e-9, 1e-9, 1e-9, 1e-6};
+        for (int a = 0; a < 4; a++)
+        {
+            report.arrays.push_back(compareArrays("toed_convolve", names[a], direct[a], reference[a], tolerances[a], true));
+        }
+
+        // Rows are independent, so thread count must not change a single bit
+        const std::string kernel = "toed_convolve(" + std::to_string(threads) + " thr)";
+        for (int a = 0; a < 4; a++)
+        {
+            report.arrays.push_back(compareArrays(kernel, names[a], reference[a], candidate[a], 0.0));
+        }
+    }
+
+    void verifyDescriptors(VerificationReport &report, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        const size_t threads = 4;
+        css::CSS serial, pooled;
+        pooled.setThreadPool(std::make_shared<parallel::ThreadPool>(threads));
+
+        // Zero crossings flattened as (arc length, sigma) pairs in descriptor order
+        std::vector<double> reference, candidate;
+        for (int n : {64, 256, 1000})
+        {
+            const std::vector<cv::Point2d> curve = randomCurve(rng, n);
+            for (const auto &zc : serial.computeCSS(curve, 4.0, 20).zeroCrossings)
+            {
+                reference.push_back(zc.first);
+                reference.push_back(zc.second);
+            }
+            for (const auto &zc : pooled.computeCSS(curve, 4.0, 20).zeroCrossings)
+            {
+                candidate.push_back(zc.first);
+                candidate.push_back(zc.second);
+            }
+        }
+
+        // Scales are computed independently and concatenated in order: identical output
+        report.arrays.push_back(compareArrays("css_descriptor(" + std::to_string(threads) + " thr)", "zero_crossings",
+                                              reference, candidate, 0.0));
+    }
+
+    VerificationReport verifyKernels(unsigned seed)
+    {
+        VerificationReport report;
+        verifyDerivatives(report, seed);
+        verifyDistances(report, seed + 1);
+        verifyConvolution(report, seed + 2);
+        verifyDescriptors(report, seed + 3);
+        return report;
+    }
+
+} // namespace verification
@@ -0,0 +1,312 @@
+#include "VideoPipeline.h"
+#include "Logging.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace recognition
+{
+
+    namespace
+    {
+        typedef std::chrono::steady_clock Clock;
+
+        double elapsedMs(Clock::time_point start, Clock::time_point end)
+        {
+            return std::chrono::duration<double, std::milli>(end - start).count();
+        }
+
+        // Log-scaled first four Hu moments: invariant to translation, scale and rotation like the
+        // CSS descriptor itself. The higher orders are dominated by pixel noise.
+        bool huSignature(const std::vector<cv::Point> &contour, std::array<double, 4> &signature)
+        {
+            const cv::Moments m = cv::moments(contour);
+            if (std::abs(m.m00) < 1e-6)
+            {
+                return false;
+            }
+
+            double hu[7];
+            cv::HuMoments(m, hu);
+            for (size_t i = 0; i < signature.size(); i++)
+            {
+                signature[i] = hu[i] == 0.0 ? 0.0 : -std::copysign(1.0, hu[i]) * std::log10(std::abs(hu[i]));
+            }
+            return true;
+        }
+
+        double signatureDistance(const std::array<double, 4> &a, const std::array<double, 4> &b)
+        {
+            double dist = 0.0;
+            for (size_t i = 0; i < a.size(); i++)
+            {
+                dist = std::max(dist, std::abs(a[i] - b[i]));
+            }
+            return dist;
+        }
+    }
+
+    VideoPipeline::VideoPipeline(Recognition &recognizer, const PipelineOptions &options)
+        : recognizer_(recognizer),
+          options_(options),
+          live_(false),
+          sourceFps_(0.0),
+          captured_(options.queueCapacity, options.dropStaleFrames),
+          extracted_(options.queueCapacity, options.dropStaleFrames),
+          described_(options.queueCapacity, options.dropStaleFrames),
+          results_(options.queueCapacity, options.dropStaleFrames),
+          referenceSignature_(),
+          referenceId_(0),
+          nextDescriptorId_(0),
+          matchedId_(0),
+          stopping_(false)
+    {
+    }
+
+    VideoPipeline::~VideoPipeline()
+    {
+        stop();
+    }
+
+    bool VideoPipeline::start(const std::string &source)
+    {
+        if (!threads_.empty())
+        {
+            CSS_LOG_ERROR("Video pipeline is already running");
+            return false;
+        }
+
+        live_ = !source.empty() && std::all_of(source.begin(), source.end(), [](unsigned char c)
+                                               { return std::isdigit(c) != 0; });
+        if (live_)
+        {
+            capture_.open(std::stoi(source));
+        }
+        else
+        {
+            capture_.open(source);
+        }
+
+        if (!capture_.isOpened())
+        {
+            CSS_LOG_ERROR("Cannot open video source: " << source);
+            return false;
+        }
+
+        sourceFps_ = live_ ? 0.0 : capture_.get(cv::CAP_PROP_FPS);
+
+        // A previous stop() closed the queues; every run starts from empty queues and fresh state
+        captured_.reopen();
+        extracted_.reopen();
+        described_.reopen();
+        results_.reopen();
+        referenceSignature_ = std::array<double, 4>();
+        referenceDescriptor_ = css::CSSImage();
+        referenceId_ = 0;
+        nextDescriptorId_ = 0;
+        matchedId_ = 0;
+        lastMatches_.clear();
+        {
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            stats_ = PipelineStats();
+            totals_ = StageTimings();
+        }
+        stopping_ = false;
+
+        CSS_LOG_INFO("Streaming from " << (live_ ? "camera " : "") << source
+                                       << " (queue capacity " << options_.queueCapacity << ")");
+
+        threads_.emplace_back(&VideoPipeline::captureLoop, this);
+        threads_.emplace_back(&VideoPipeline::extractLoop, this);
+        threads_.emplace_back(&VideoPipeline::describeLoop, this);
+        threads_.emplace_back(&VideoPipeline::matchLoop, this);
+        return true;
+    }
+
+    bool VideoPipeline::nextResult(FrameResult &result)
+    {
+        // Counted on delivery: a frame the results queue drops is only counted as dropped
+        if (!results_.pop(result))
+        {
+            return false;
+        }
+        record(result);
+        return true;
+    }
+
+    void VideoPipeline::stop()
+    {
+        stopping_ = true;
+        captured_.close(true);
+        extracted_.close(true);
+        described_.close(true);
+        results_.close(true);
+
+        for (auto &thread : threads_)
+        {
+            thread.join();
+        }
+        threads_.clear();
+        capture_.release();
+    }
+
+    PipelineStats VideoPipeline::stats() const
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        PipelineStats stats = stats_;
+        stats.framesDropped = captured_.dropped() + extracted_.dropped() + described_.dropped() + results_.dropped();
+        return stats;
+    }
+
+    // ============================================================================
+    // Stages
+    // ============================================================================
+
+    void VideoPipeline::captureLoop()
+    {
+        const Clock::time_point streamStart = Clock::now();
+        uint64_t index = 0;
+        while (!stopping_)
+        {
+            FrameResult item;
+            const Clock::time_point start = Clock::now();
+            if (!capture_.read(item.frame) || item.frame.empty())
+            {
+                break;
+            }
+            item.captured = Clock::now();
+            item.timings.capture = elapsedMs(start, item.captured);
+            item.frameIndex = index++;
+
+            {
+                std::lock_guard<std::mutex> lock(statsMutex_);
+                stats_.framesCaptured++;
+            }
+
+            if (!captured_.push(std::move(item)))
+            {
+                break;
+            }
+
+            // A file is decoded faster than real time; hold it to its nominal frame rate
+            if (options_.paceToFrameRate && sourceFps_ > 0.0)
+            {
+                std::this_thread::sleep_until(streamStart + std::chrono::duration_cast<Clock::duration>(
+                                                                std::chrono::duration<double>(index / sourceFps_)));
+            }
+        }
+        captured_.close();
+    }
+
+    void VideoPipeline::extractLoop()
+    {
+        FrameResult item;
+        while (captured_.pop(item))
+        {
+            const Clock::time_point start = Clock::now();
+            item.found = recognizer_.extractQuery(item.frame, item.query);
+            item.timings.extract = elapsedMs(start, Clock::now());
+
+            if (!extracted_.push(std::move(item)))
+            {
+                break;
+            }
+        }
+        extracted_.close();
+    }
+
+    void VideoPipeline::describeLoop()
+    {
+        FrameResult item;
+        while (extracted_.pop(item))
+        {
+            if (item.found)
+            {
+                const Clock::time_point start = Clock::now();
+
+                // Compared with the last described frame, not the previous one, so slow drift
+                // still leads to a new descriptor eventually
+                std::array<double, 4> signature;
+                const bool hasSignature = options_.temporalReuse && huSignature(item.query.contour, signature);
+                if (hasSignature && referenceId_ != 0 &&
+                    signatureDistance(signature, referenceSignature_) <= options_.reuseTolerance)
+                {
+                    item.descriptor = referenceDescriptor_;
+                    item.descriptorId = referenceId_;
+                    item.reused = true;
+                }
+                else
+                {
+                    item.descriptor = recognizer_.describeQuery(item.query);
+                    item.descriptorId = ++nextDescriptorId_;
+                    referenceId_ = hasSignature ? item.descriptorId : 0;
+                    if (hasSignature)
+                    {
+                        referenceSignature_ = signature;
+                        referenceDescriptor_ = item.descriptor;
+                    }
+                }
+                item.timings.describe = elapsedMs(start, Clock::now());
+            }
+
+            if (!described_.push(std::move(item)))
+            {
+                break;
+            }
+        }
+        described_.close();
+    }
+
+    void VideoPipeline::matchLoop()
+    {
+        FrameResult item;
+        while (described_.pop(item))
+        {
+            const Clock::time_point start = Clock::now();
+            if (item.found && item.descriptorId == matchedId_)
+            {
+                item.matches = lastMatches_;
+            }
+            else if (item.found)
+            {
+                // The previous top-K bounds the scan when the object has changed only a little
+                item.matches = options_.temporalReuse && !lastMatches_.empty()
+                                   ? recognizer_.matchQuery(item.descriptor, options_.topK, lastMatches_)
+                                   : recognizer_.matchQuery(item.descriptor, options_.topK);
+                matchedId_ = item.descriptorId;
+                lastMatches_ = item.matches;
+            }
+            const Clock::time_point end = Clock::now();
+            item.timings.match = elapsedMs(start, end);
+            item.timings.latency = elapsedMs(item.captured, end);
+
+            if (!results_.push(std::move(item)))
+            {
+                break;
+            }
+        }
+        results_.close();
+    }
+
+    void VideoPipeline::record(const FrameResult &result)
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        stats_.framesProcessed++;
+        stats_.framesReused += result.reused ? 1 : 0;
+        stats_.last = result.timings;
+
+        totals_.capture += result.timings.capture;
+        totals_.extract += result.timings.extract;
+        totals_.describe += result.timings.describe;
+        totals_.match += result.timings.match;
+        totals_.latency += result.timings.latency;
+
+        const double n = static_cast<double>(stats_.framesProcessed);
+        stats_.mean.capture = totals_.capture / n;
+        stats_.mean.extract = totals_.extract / n;
+        stats_.mean.describe = totals_.describe / n;
+        stats_.mean.match = totals_.match / n;
+        stats_.mean.latency = totals_.latency / n;
+    }
+
+} // namespace recognition
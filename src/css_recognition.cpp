@@ -69,7 +69,8 @@ void demoMode(const std::string &imagePath)
 
     // Save CSS image
     std::string cssPath = imagePath.substr(0, imagePath.find_last_of('.')) + "_css.png";
-    cv::imwrite(cssPath, cssImg.image);
+    cv::Mat cssVisual = cssComputer.visualizeCSSImage(cssImg);
+    cv::imwrite(cssPath, cssVisual);
     std::cout << "CSS image saved to: " << cssPath << std::endl;
 
     // Save GIF
@@ -78,7 +79,7 @@ void demoMode(const std::string &imagePath)
 
     // Display results
     cv::imshow("Original", img);
-    cv::imshow("CSS Image", cssImg.image);
+    cv::imshow("CSS Image", cssVisual);
     if (!frames.empty())
     {
         cv::imshow("Final Frame", frames.back());
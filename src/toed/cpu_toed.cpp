@@ -1,6 +1,8 @@
 #ifndef CPU_TOED_CPP
 #define CPU_TOED_CPP
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <math.h>
 #include <fstream>
@@ -8,9 +10,9 @@
 #include <string.h>
 #include <vector>
 
-#include <omp.h>
 #include <opencv2/opencv.hpp>
 
+#include "../../include/ThreadPool.h"
 #include "../../include/toed/cpu_toed.hpp"
 #include "../../include/toed/definitions.h"
 
@@ -18,6 +20,12 @@
 // Third-Order Edge Detection: This code is borrowed from https://github.com/C-H-Chien/Third-Order-Edge-Detector
 // ==============================================================================================================
 
+//> Wall-clock seconds for the stage timings
+static double wall_time()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 // ==================================== Constructor ===================================
 // Define parameters used by functions in the class and allocate 2d arrays dynamically
 // ====================================================================================
@@ -35,16 +43,9 @@ ThirdOrderEdgeDetectionCPU::ThirdOrderEdgeDetectionCPU(int H, int W)
     interp_img_height = img_height * 2;
     interp_img_width = img_width * 2;
 
-    //> Define openmp threads, either use the available number of cores on tha machine or define the use of cores
-#if ACTIVATE_OPENMP_SUPPORT
-#if USE_DEFINED_NUM_OF_CORES
-    omp_threads = USE_NUM_CORES_FOR_OMP;
-#else
-    omp_threads = omp_get_num_procs();
-#endif
-#else
-    omp_threads = 1;
-#endif
+    //> Parallel loops run on the owner's thread pool once it is set
+    pool = nullptr;
+
     img = new double[img_height * img_width];
 
     // -- interpolated image map --
@@ -160,9 +161,8 @@ void ThirdOrderEdgeDetectionCPU::convolve_img()
     double Gxxx_sh[] = {0.000190921146395817, 0.000914200719419500, 0.00311688729895755, 0.00713098700075939, 0.00920573886249338, 0.000589786359165606, -0.0205123484567749, -0.0344073042598751, -0.0177474623923183, 0.0177474623923183, 0.0344073042598751, 0.0205123484567749, -0.000589786359165606, -0.00920573886249338, -0.00713098700075939, -0.00311688729895755, -0.000914200719419500, -0.000190921146395817, -2.92094529738860e-05};
 
     // -- do convolution and compute gradient magnitude --
-    omp_set_num_threads(omp_threads);
-    double start = omp_get_wtime();
-#pragma omp parallel
+    double start = wall_time();
+    parallel::parallelFor(pool, 0, img_height, TOED_ROWS_PER_TASK, [&](size_t row_begin, size_t row_end)
     {
         double TO_conv_Ix, TO_conv_Iy;
         double TO_conv_mag;
@@ -177,9 +177,9 @@ void ThirdOrderEdgeDetectionCPU::convolve_img()
         double fxxx;
         double fyyy;
 
-#pragma omp for schedule(dynamic)
         // -- do convolution --
-        for (int i = 0; i < img_height; i++)
+        CSS_TRACE_SCOPE_ARG("toed.convolve_rows", "row_begin", row_begin);
+        for (int i = static_cast<int>(row_begin); i < static_cast<int>(row_end); i++)
         {
             for (int j = 0; j < img_width; j++)
             {
@@ -362,10 +362,11 @@ void ThirdOrderEdgeDetectionCPU::convolve_img()
                 // I_orient(si + 1, sj + 1) = std::atan(TO_conv_Ix / -TO_conv_Iy);
             }
         }
-    }
-    double test_time = omp_get_wtime() - start;
-    // std::cout<<"- Time of image convolution (OpenMP): "<<test_time*1000<<" (ms)"<<std::endl;
+    });
+    double test_time = wall_time() - start;
+    CSS_LOG_DEBUG("Time of image convolution: " << test_time * 1000 << " (ms)");
     time_conv = test_time;
+    CSS_PROFILE_RECORD("toed.convolve", test_time * 1000);
 
 #if WriteDataToFile
     write_array_to_file("Ix_cpu.txt", Ix, interp_img_height, interp_img_width);
@@ -387,9 +388,10 @@ int ThirdOrderEdgeDetectionCPU::non_maximum_suppresion()
 {
     const int sn = 1;
 
-    omp_set_num_threads(omp_threads);
-    double start = omp_get_wtime();
-#pragma omp parallel
+    double start = wall_time();
+    const int first_col = 10;
+    const int last_col = std::max(first_col, interp_img_width - 10);
+    parallel::parallelFor(pool, first_col, last_col, TOED_COLS_PER_TASK, [&](size_t col_begin, size_t col_end)
     {
         double norm_dir_x, norm_dir_y;
         double slope, fp, fm;
@@ -397,8 +399,7 @@ int ThirdOrderEdgeDetectionCPU::non_maximum_suppresion()
         double max_f, subpix_grad_x, subpix_grad_y;
         double subpix_grad_mag;
 
-#pragma omp for schedule(dynamic)
-        for (int j = 10; j < interp_img_width - 10; j += sn)
+        for (int j = static_cast<int>(col_begin); j < static_cast<int>(col_end); j += sn)
         {
             for (int i = 10; i < interp_img_height - 10; i += sn)
             {
@@ -512,10 +513,11 @@ int ThirdOrderEdgeDetectionCPU::non_maximum_suppresion()
                 }
             }
         }
-    }
-    double end = omp_get_wtime() - start;
-    // std::cout<<"- Time of NMS (OpenMP): "<<end*1000<<" (ms)"<<std::endl;
+    });
+    double end = wall_time() - start;
+    CSS_LOG_DEBUG("Time of NMS: " << end * 1000 << " (ms)");
     time_nms = end;
+    CSS_PROFILE_RECORD("toed.nms", end * 1000);
 
 #if WriteDataToFile
     write_array_to_file("subpix_pos_x_map_cpu.txt", subpix_pos_x_map, interp_img_height, interp_img_width);
@@ -588,13 +590,13 @@ void ThirdOrderEdgeDetectionCPU::write_array_to_file(std::string filename, doubl
 {
 #define wr_data(i, j) wr_data[(i) * second_dim + (j)]
 
-    std::cout << "writing data to a file " << filename << " ..." << std::endl;
+    LOG_INFO("writing data to a file " + filename + " ...");
     std::string out_file_name = "../output_files/";
     out_file_name.append(filename);
     std::ofstream out_file;
     out_file.open(out_file_name);
     if (!out_file.is_open())
-        std::cout << "write data file cannot be opened!" << std::endl;
+        LOG_ERROR("write data file cannot be opened!");
 
     for (int i = 0; i < first_dim; i++)
     {
@@ -615,7 +617,7 @@ void ThirdOrderEdgeDetectionCPU::write_array_to_file(std::string filename, doubl
 void ThirdOrderEdgeDetectionCPU::read_array_from_file(std::string filename, double *rd_data, int first_dim, int second_dim)
 {
 #define rd_data(i, j) rd_data[(i) * second_dim + (j)]
-    std::cout << "reading data from a file " << filename << std::endl;
+    LOG_INFO("reading data from a file " + filename);
     std::string in_file_name = "./test_files/";
     in_file_name.append(filename);
     std::fstream in_file;
@@ -625,7 +627,7 @@ void ThirdOrderEdgeDetectionCPU::read_array_from_file(std::string filename, doub
     in_file.open(in_file_name, std::ios_base::in);
     if (!in_file)
     {
-        std::cerr << "input read file not existed!\n";
+        LOG_FILE_ERROR(in_file_name);
     }
     else
     {
@@ -0,0 +1,120 @@
+#ifndef EDGE_GRID_CPP
+#define EDGE_GRID_CPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../../include/toed/edge_grid.hpp"
+
+// ==================================== Constructor ===================================
+// Grid covering an img_height x img_width image with square cells of cell_size pixels
+// ====================================================================================
+EdgeGrid::EdgeGrid(int img_height, int img_width, double cell_size)
+    : cell_size(cell_size > 0 ? cell_size : GRID_SIZE), edges(nullptr)
+{
+    grid_rows = std::max(1, static_cast<int>(std::ceil(img_height / this->cell_size)));
+    grid_cols = std::max(1, static_cast<int>(std::ceil(img_width / this->cell_size)));
+    cell_start.assign(grid_rows * grid_cols + 1, 0);
+}
+
+int EdgeGrid::cell_index(const cv::Point2d &p) const
+{
+    //> edges outside the image are kept in the border cells
+    const int gx = std::min(grid_cols - 1, std::max(0, static_cast<int>(p.x / cell_size)));
+    const int gy = std::min(grid_rows - 1, std::max(0, static_cast<int>(p.y / cell_size)));
+    return gy * grid_cols + gx;
+}
+
+// ====================================== build =======================================
+// Counting sort of edge indices by cell: count, prefix-sum, scatter
+// ====================================================================================
+void EdgeGrid::build(const std::vector<Edge> &edge_list)
+{
+    edges = &edge_list;
+    std::fill(cell_start.begin(), cell_start.end(), 0);
+
+    std::vector<int> cells(edge_list.size());
+    for (size_t i = 0; i < edge_list.size(); i++)
+    {
+        cells[i] = cell_index(edge_list[i].location);
+        cell_start[cells[i] + 1]++;
+    }
+
+    for (size_t c = 1; c < cell_start.size(); c++)
+    {
+        cell_start[c] += cell_start[c - 1];
+    }
+
+    cell_edges.resize(edge_list.size());
+    std::vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+    for (size_t i = 0; i < edge_list.size(); i++)
+    {
+        cell_edges[fill[cells[i]]++] = static_cast<int>(i);
+    }
+}
+
+std::vector<int> EdgeGrid::query(const cv::Point2d &p, double radius) const
+{
+    std::vector<int> found;
+    for_each_neighbor(p, radius, [&found](int idx)
+                      { found.push_back(idx); });
+    return found;
+}
+
+// =================================== cluster_edges ==================================
+// Greedy clustering: every unassigned edge seeds a cluster of its compatible neighbors
+// ====================================================================================
+std::vector<Edge> cluster_edges(const std::vector<Edge> &edges, const EdgeGrid &grid,
+                                double dist_thresh, double orient_thresh, int max_cluster_size)
+{
+    const double orient_thresh_rad = orient_thresh * PI / 180.0;
+
+    std::vector<Edge> clustered;
+    clustered.reserve(edges.size());
+    std::vector<char> assigned(edges.size(), 0);
+    std::vector<int> members;
+
+    for (size_t seed = 0; seed < edges.size(); seed++)
+    {
+        if (assigned[seed])
+            continue;
+
+        members.clear();
+        members.push_back(static_cast<int>(seed));
+        assigned[seed] = 1;
+
+        const Edge &s = edges[seed];
+        grid.for_each_neighbor(s.location, dist_thresh, [&](int idx)
+                               {
+            if (assigned[idx] || static_cast<int>(members.size()) >= max_cluster_size)
+                return;
+
+            //> orientation difference wrapped to [-pi, pi]
+            const double d_orient = std::remainder(edges[idx].orientation - s.orientation, 2.0 * PI);
+            if (std::abs(d_orient) > orient_thresh_rad)
+                return;
+
+            members.push_back(idx);
+            assigned[idx] = 1; });
+
+        //> mean location and circular mean orientation
+        double sum_x = 0.0, sum_y = 0.0, sum_cos = 0.0, sum_sin = 0.0;
+        for (int idx : members)
+        {
+            sum_x += edges[idx].location.x;
+            sum_y += edges[idx].location.y;
+            sum_cos += std::cos(edges[idx].orientation);
+            sum_sin += std::sin(edges[idx].orientation);
+        }
+
+        Edge merged(cv::Point2d(sum_x / members.size(), sum_y / members.size()),
+                    std::atan2(sum_sin, sum_cos), false, s.frame_source);
+        merged.index = static_cast<int>(clustered.size());
+        clustered.push_back(merged);
+    }
+
+    return clustered;
+}
+
+#endif // EDGE_GRID_CPP